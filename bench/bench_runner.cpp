@@ -0,0 +1,600 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../common/fast_output.h"
+#include "../common/perf_counters.h"
+#include "dna_generator.h"
+
+using std::string;
+using std::vector;
+
+// Benchmark runner for the engines of every week. For each engine, profile and
+// size it generates a seeded input in the format of the engine, runs the engine
+// binary on it and reports the measurements as JSON.
+//
+// The hardware events of common/perf_counters.h are counted for the whole run
+// and reported in total, per character and per query. Engines built with
+// STRINGS_INSTRUMENT also report their phases, which get the same figures.
+//
+// Usage: bench_runner [options]
+//   --bin-dir DIR     directory with the engine binaries (default: .)
+//   --engine NAME     run only this engine, or the engines of this binary,
+//                     can be repeated (default: all)
+//   --profile NAME    uniform, low-entropy or repetitive, can be repeated (default: all)
+//   --min-size N      smallest text size (default: 1000)
+//   --max-size N      largest text size, sizes grow by 10x (default: 1000000)
+//   --seed N          seed of the generated data (default: 1)
+//   --repeat N        runs per input, the fastest one is reported (default: 3)
+//   --timeout S       CPU seconds allowed per run (default: 600)
+//   --work-dir DIR    where the generated inputs are cached (default: /tmp/strings-bench)
+//   --output FILE     write the JSON there instead of standard output
+//   --no-caps         also run engines on sizes beyond their complexity cap
+//   --list            print the engine names and exit
+
+// Characters and queries in a generated input, used to normalise the measurements
+struct InputInfo {
+    size_t characters;
+    size_t queries;
+};
+
+// An engine binary with its arguments and the writer of its input format
+struct Engine {
+    string name;
+    string binary;
+    vector<string> args;
+    // Largest size the engine handles in reasonable time, given its complexity
+    size_t max_size;
+    std::function<InputInfo(OutputWriter&, size_t, Profile, uint64_t)> write_input;
+};
+
+// Write the strings separated by spaces and ended by a newline
+void write_list(OutputWriter& out, const vector<string>& items) {
+    for (size_t i = 0; i < items.size(); ++i) {
+        out.write(items[i]);
+        out.put(i + 1 < items.size() ? ' ' : '\n');
+    }
+}
+
+void write_ints(OutputWriter& out, const vector<int>& items) {
+    for (size_t i = 0; i < items.size(); ++i) {
+        out.write_int(items[i]);
+        out.put(i + 1 < items.size() ? ' ' : '\n');
+    }
+}
+
+// Number of queries for a text of the given size
+size_t query_count(size_t size) {
+    return std::min<size_t>(100000, std::max<size_t>(10, size / 10));
+}
+
+// Text followed by a count of reads and the reads
+std::function<InputInfo(OutputWriter&, size_t, Profile, uint64_t)> text_and_reads(size_t read_length, int substitutions) {
+    return [=] (OutputWriter& out, size_t size, Profile profile, uint64_t seed) {
+        string text = generate_dna(size, profile, seed);
+        vector<string> reads = sample_reads(text, query_count(size), read_length, substitutions, seed + 1);
+        out.write(text);
+        out.put('\n');
+        out.write_int(reads.size());
+        out.put('\n');
+        write_list(out, reads);
+        return InputInfo{size, reads.size()};
+    };
+}
+
+// BWT of the text followed by a count of reads and the reads
+std::function<InputInfo(OutputWriter&, size_t, Profile, uint64_t)> bwt_and_reads(size_t read_length, int substitutions) {
+    return [=] (OutputWriter& out, size_t size, Profile profile, uint64_t seed) {
+        string text = generate_dna(size, profile, seed);
+        vector<string> reads = sample_reads(text, query_count(size), read_length, substitutions, seed + 1);
+        text += '$';
+        out.write(build_bwt(text, build_suffix_array(text)));
+        out.put('\n');
+        out.write_int(reads.size());
+        out.put('\n');
+        write_list(out, reads);
+        return InputInfo{size, reads.size()};
+    };
+}
+
+// The BWT of the text and long reads, together about as long as the text
+std::function<InputInfo(OutputWriter&, size_t, Profile, uint64_t)> bwt_and_long_reads(size_t read_length, int substitutions) {
+    return [=] (OutputWriter& out, size_t size, Profile profile, uint64_t seed) {
+        string text = generate_dna(size, profile, seed);
+        size_t count = std::max<size_t>(1, std::min(query_count(size), size / read_length));
+        vector<string> reads = sample_reads(text, count, read_length, substitutions, seed + 1);
+        text += '$';
+        out.write(build_bwt(text, build_suffix_array(text)));
+        out.put('\n');
+        out.write_int(reads.size());
+        out.put('\n');
+        write_list(out, reads);
+        return InputInfo{size, reads.size()};
+    };
+}
+
+// Only the text ended by '$'
+InputInfo text_with_sentinel(OutputWriter& out, size_t size, Profile profile, uint64_t seed) {
+    out.write(generate_dna(size, profile, seed));
+    out.write("$\n", 2);
+    return InputInfo{size, 0};
+}
+
+// The text ended by '$', a count of queries and random pairs of positions
+InputInfo text_and_position_pairs(OutputWriter& out, size_t size, Profile profile, uint64_t seed) {
+    out.write(generate_dna(size, profile, seed));
+    out.write("$\n", 2);
+    size_t count = query_count(size);
+    Random random(seed + 1);
+    out.write_int(count);
+    out.put('\n');
+    for (size_t q = 0; q < count; ++q) {
+        out.write_int(random.below(size + 1));
+        out.put(' ');
+        out.write_int(random.below(size + 1));
+        out.put('\n');
+    }
+    return InputInfo{size, count};
+}
+
+// The text ended by '$', its suffix array and its LCP array
+InputInfo text_suffix_array_and_lcp(OutputWriter& out, size_t size, Profile profile, uint64_t seed) {
+    string text = generate_dna(size, profile, seed) + '$';
+    vector<int> suffix_array = build_suffix_array(text);
+    out.write(text);
+    out.put('\n');
+    write_ints(out, suffix_array);
+    write_ints(out, build_lcp_array(text, suffix_array));
+    return InputInfo{size, 0};
+}
+
+// Two unrelated texts of half the size each
+InputInfo two_texts(OutputWriter& out, size_t size, Profile profile, uint64_t seed) {
+    out.write(generate_dna(size / 2, profile, seed));
+    out.put('\n');
+    out.write(generate_dna(size - size / 2, profile, seed + 1));
+    out.put('\n');
+    return InputInfo{size, 1};
+}
+
+// The text as FASTA, wrapped at 60 letters per line
+InputInfo fasta(OutputWriter& out, size_t size, Profile profile, uint64_t seed) {
+    string text = generate_dna(size, profile, seed);
+    out.write(">synthetic\n");
+    for (size_t i = 0; i < size; i += 60) {
+        out.write(text.data() + i, std::min<size_t>(60, size - i));
+        out.put('\n');
+    }
+    return InputInfo{size, 0};
+}
+
+vector<Engine> all_engines() {
+    vector<Engine> engines;
+
+    engines.push_back(Engine{"trie", "trie", {}, 10000000,
+        [] (OutputWriter& out, size_t size, Profile profile, uint64_t seed) {
+            // Primers of length 20 adding up to the size
+            string text = generate_dna(size, profile, seed);
+            vector<string> primers = sample_reads(text, std::max<size_t>(1, size / 20), 20, 0, seed + 1);
+            out.write_int(primers.size());
+            out.put('\n');
+            for (const auto& primer : primers) {
+                out.write(primer);
+                out.put('\n');
+            }
+            return InputInfo{size, primers.size()};
+        }});
+
+    engines.push_back(Engine{"trie_matching", "trie_matching", {}, 100000000, text_and_reads(12, 0)});
+    engines.push_back(Engine{"trie_matching_extended", "trie_matching_extended", {}, 100000000, text_and_reads(12, 0)});
+    engines.push_back(Engine{"bwt", "bwt", {}, 10000, text_with_sentinel});
+
+    engines.push_back(Engine{"bwtinverse", "bwtinverse", {}, 100000000,
+        [] (OutputWriter& out, size_t size, Profile profile, uint64_t seed) {
+            string text = generate_dna(size, profile, seed) + '$';
+            out.write(build_bwt(text, build_suffix_array(text)));
+            out.put('\n');
+            return InputInfo{size, 0};
+        }});
+
+    engines.push_back(Engine{"bwt_compress", "bwt_compress", {}, 100000000, fasta});
+    engines.push_back(Engine{"bwmatching", "bwmatching", {}, 100000000, bwt_and_reads(20, 0)});
+    engines.push_back(Engine{"bwmatching-unbatched", "bwmatching", {"--batch", "1"}, 100000000, bwt_and_reads(20, 0)});
+    engines.push_back(Engine{"bwmatching-kmers8", "bwmatching", {"--kmers", "8"}, 100000000, bwt_and_reads(20, 0)});
+    engines.push_back(Engine{"bwmatching-kmers10", "bwmatching", {"--kmers", "10"}, 100000000, bwt_and_reads(20, 0)});
+    engines.push_back(Engine{"bwmatching-kmers12", "bwmatching", {"--kmers", "12"}, 100000000, bwt_and_reads(20, 0)});
+    engines.push_back(Engine{"bwmatching-wavelet", "bwmatching", {"--wavelet"}, 100000000, bwt_and_reads(20, 0)});
+    engines.push_back(Engine{"bwmatching-k1", "bwmatching", {"-k", "1"}, 100000000, bwt_and_reads(50, 2)});
+    engines.push_back(Engine{"bwmatching-k2", "bwmatching", {"-k", "2"}, 100000000, bwt_and_reads(50, 2)});
+    engines.push_back(Engine{"bwmatching-smem", "bwmatching", {"--smem", "19"}, 10000000, bwt_and_long_reads(10000, 100)});
+    engines.push_back(Engine{"bwmatching-rlbwt", "bwmatching", {"--rlbwt"}, 100000000, bwt_and_reads(20, 0)});
+    engines.push_back(Engine{"bwmatching-locate", "bwmatching", {"--locate"}, 100000000, bwt_and_reads(20, 0)});
+    engines.push_back(Engine{"suffix_array", "suffix_array", {}, 10000, text_with_sentinel});
+    engines.push_back(Engine{"suffix_array_long", "suffix_array_long", {}, 100000000, text_with_sentinel});
+    engines.push_back(Engine{"suffix_array_long-repeats", "suffix_array_long", {"--maximal-repeats", "20"}, 100000000, text_with_sentinel});
+    engines.push_back(Engine{"suffix_array_long-mums", "suffix_array_long", {"--mums", "20"}, 100000000, two_texts});
+    engines.push_back(Engine{"suffix_array_long-lce", "suffix_array_long", {"--lce", "16"}, 100000000, text_and_position_pairs});
+    engines.push_back(Engine{"suffix_array_matching", "suffix_array_matching", {}, 100000000, text_and_reads(20, 0)});
+    engines.push_back(Engine{"suffix_array_matching-k2", "suffix_array_matching", {"-k", "2"}, 100000000, text_and_reads(100, 2)});
+    engines.push_back(Engine{"suffix_array_matching-csa", "suffix_array_matching", {"--csa"}, 100000000, text_and_reads(20, 0)});
+
+    engines.push_back(Engine{"kmp", "kmp", {}, 100000000,
+        [] (OutputWriter& out, size_t size, Profile profile, uint64_t seed) {
+            string text = generate_dna(size, profile, seed);
+            out.write(sample_reads(text, 1, 12, 0, seed + 1)[0]);
+            out.put('\n');
+            out.write(text);
+            out.put('\n');
+            return InputInfo{size, 1};
+        }});
+
+    engines.push_back(Engine{"suffix_tree", "suffix_tree", {}, 5000, text_with_sentinel});
+
+    engines.push_back(Engine{"suffix_tree_from_array", "suffix_tree_from_array", {}, 10000000, text_suffix_array_and_lcp});
+    engines.push_back(Engine{"suffix_tree_from_array-stream", "suffix_tree_from_array", {"--stream"}, 10000000, text_suffix_array_and_lcp});
+
+    engines.push_back(Engine{"non_shared_substring", "non_shared_substring", {}, 100000000, two_texts});
+    engines.push_back(Engine{"non_shared_substring-trie", "non_shared_substring", {"--trie"}, 4000, two_texts});
+
+    return engines;
+}
+
+// Named values of an event or a phase
+typedef vector<std::pair<string, double>> Values;
+
+// Measurements of one run of an engine
+struct Run {
+    int exit_status;
+    double wall_seconds;
+    double user_seconds;
+    double system_seconds;
+    long max_rss_kb;
+    // Hardware events of the whole run, empty when none is available
+    Values events;
+    // Summary written by an instrumented engine, empty otherwise
+    string phases_json;
+};
+
+string read_file(const string& path) {
+    string content;
+    FILE* file = fopen(path.c_str(), "r");
+    if (file == nullptr) return content;
+    char chunk[4096];
+    size_t count;
+    while ((count = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        content.append(chunk, count);
+    }
+    fclose(file);
+    return content;
+}
+
+// Run the binary with standard input redirected from the input file and
+// standard output discarded, and collect its resource usage and hardware
+// events. The child waits on a pipe until the counters are attached to it,
+// they start counting when it calls exec.
+Run run_engine(const string& binary, const vector<string>& args, const string& input, int timeout,
+               const string& phases_path) {
+    Run run = {-1, 0, 0, 0, 0, Values(), string()};
+    unlink(phases_path.c_str());
+    int ready[2];
+    if (pipe(ready) != 0) return run;
+    auto begin = std::chrono::steady_clock::now();
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        int in = open(input.c_str(), O_RDONLY);
+        int out = open("/dev/null", O_WRONLY);
+        if (in < 0 || out < 0) _exit(127);
+        dup2(in, 0);
+        dup2(out, 1);
+        setenv("STRINGS_INSTRUMENT_OUTPUT", phases_path.c_str(), 1);
+
+        // Bound the CPU time like the graders do, the stack keeps its limit
+        struct rlimit cpu = {rlim_t(timeout), rlim_t(timeout)};
+        setrlimit(RLIMIT_CPU, &cpu);
+
+        // Wait for the counters
+        close(ready[1]);
+        char byte;
+        while (read(ready[0], &byte, 1) > 0) {}
+        close(ready[0]);
+
+        vector<char*> argv;
+        argv.push_back(const_cast<char*>(binary.c_str()));
+        for (const auto& arg : args) argv.push_back(const_cast<char*>(arg.c_str()));
+        argv.push_back(nullptr);
+        execv(binary.c_str(), argv.data());
+        _exit(127);
+    }
+    close(ready[0]);
+    if (pid < 0) {
+        close(ready[1]);
+        return run;
+    }
+
+    PerfCounters counters;
+    counters.open(pid, true);
+    close(ready[1]);
+
+    int status = 0;
+    struct rusage usage;
+    wait4(pid, &status, 0, &usage);
+    auto end = std::chrono::steady_clock::now();
+
+    uint64_t events[PerfCounters::Events];
+    counters.read(events);
+    for (int e = 0; e < PerfCounters::Events; ++e) {
+        if (counters.available(e)) run.events.push_back(std::make_pair(string(PerfCounters::name(e)), double(events[e])));
+    }
+    run.phases_json = read_file(phases_path);
+
+    run.exit_status = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    run.wall_seconds = std::chrono::duration<double>(end - begin).count();
+    run.user_seconds = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec * 1e-6;
+    run.system_seconds = usage.ru_stime.tv_sec + usage.ru_stime.tv_usec * 1e-6;
+    run.max_rss_kb = usage.ru_maxrss;
+    return run;
+}
+
+// Append printf-style formatted text to s, formatted in place at its end
+void append(string& s, const char* format, ...) {
+    va_list args, retry;
+    va_start(args, format);
+    va_copy(retry, args);
+    size_t size = s.size();
+    s.resize(size + 256);
+    int length = vsnprintf(&s[size], 257, format, args);
+    if (length > 256) {
+        s.resize(size + length);
+        vsnprintf(&s[size], length + 1, format, retry);
+    }
+    s.resize(size + std::max(length, 0));
+    va_end(retry);
+    va_end(args);
+}
+
+// Get the name and the numeric fields of every phase in the summary of an
+// instrumented engine, which has one flat object per phase
+vector<std::pair<string, Values>> parse_phases(const string& json) {
+    vector<std::pair<string, Values>> phases;
+    size_t pos = json.find("\"phases\"");
+    if (pos == string::npos) return phases;
+    size_t end = json.find(']', pos);
+
+    // Iterate over the objects of the phases array
+    for (pos = json.find('{', pos); pos < end; pos = json.find('{', pos)) {
+        size_t close = json.find('}', pos);
+        std::pair<string, Values> phase;
+
+        // Iterate over the "key": value pairs of the object
+        for (size_t key = json.find('"', pos); key < close; key = json.find('"', key)) {
+            size_t key_end = json.find('"', key + 1);
+            string name = json.substr(key + 1, key_end - key - 1);
+            size_t value = json.find_first_not_of(": ", key_end + 1);
+            if (json[value] == '"') {
+                key = json.find('"', value + 1) + 1;
+                if (name == "name") phase.first = json.substr(value + 1, key - value - 2);
+            } else {
+                char* value_end;
+                phase.second.push_back(std::make_pair(name, strtod(json.c_str() + value, &value_end)));
+                key = value_end - json.c_str();
+            }
+        }
+        phases.push_back(phase);
+        pos = close + 1;
+    }
+    return phases;
+}
+
+// Check if a field of a phase is one of the hardware events
+bool is_event(const string& name) {
+    for (int e = 0; e < PerfCounters::Events; ++e) {
+        if (name == PerfCounters::name(e)) return true;
+    }
+    return false;
+}
+
+// Append the events as "events": {"name": {"total", "per_char", "per_query"}, ...},
+// normalised by the characters and the queries of the input
+void append_events(string& s, const Values& events, const InputInfo& info) {
+    s += "\"events\": {";
+    bool first = true;
+    for (const auto& event : events) {
+        if (!is_event(event.first)) continue;
+        append(s, "%s\"%s\": {\"total\": %.0f, \"per_char\": %.4f", first ? "" : ", ", event.first.c_str(),
+               event.second, event.second / std::max<size_t>(1, info.characters));
+        if (info.queries > 0) append(s, ", \"per_query\": %.2f", event.second / info.queries);
+        s += "}";
+        first = false;
+    }
+    s += "}";
+}
+
+// Append the phases of an instrumented engine with their time and events,
+// normalised like the whole run
+void append_phases(string& s, const string& json, const InputInfo& info) {
+    s += "\"phases\": [";
+    vector<std::pair<string, Values>> phases = parse_phases(json);
+    for (size_t i = 0; i < phases.size(); ++i) {
+        append(s, "%s{\"name\": \"%s\"", i == 0 ? "" : ", ", phases[i].first.c_str());
+        for (const auto& field : phases[i].second) {
+            if (is_event(field.first)) continue;
+            append(s, ", \"%s\": %.10g", field.first.c_str(), field.second);
+            if (field.first == "seconds") {
+                append(s, ", \"ns_per_char\": %.3f", field.second * 1e9 / std::max<size_t>(1, info.characters));
+            }
+        }
+        s += ", ";
+        append_events(s, phases[i].second, info);
+        s += "}";
+    }
+    s += "]";
+}
+
+bool file_exists(const string& path) {
+    struct stat info;
+    return stat(path.c_str(), &info) == 0;
+}
+
+int main(int argc, char** argv) {
+    // Parse the options
+    string bin_dir = ".";
+    string work_dir = "/tmp/strings-bench";
+    string output_path;
+    vector<string> engine_names;
+    vector<Profile> profiles;
+    size_t min_size = 1000;
+    size_t max_size = 1000000;
+    uint64_t seed = 1;
+    int repeat = 3;
+    int timeout = 600;
+    bool caps = true;
+
+    vector<Engine> engines = all_engines();
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--bin-dir" && has_value) {
+            bin_dir = argv[++i];
+        } else if (arg == "--engine" && has_value) {
+            engine_names.push_back(argv[++i]);
+        } else if (arg == "--profile" && has_value) {
+            Profile profile;
+            if (!parse_profile(argv[++i], profile)) {
+                fprintf(stderr, "unknown profile %s\n", argv[i]);
+                return 1;
+            }
+            profiles.push_back(profile);
+        } else if (arg == "--min-size" && has_value) {
+            min_size = std::stoull(argv[++i]);
+        } else if (arg == "--max-size" && has_value) {
+            max_size = std::stoull(argv[++i]);
+        } else if (arg == "--seed" && has_value) {
+            seed = std::stoull(argv[++i]);
+        } else if (arg == "--repeat" && has_value) {
+            repeat = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--timeout" && has_value) {
+            timeout = std::stoi(argv[++i]);
+        } else if (arg == "--work-dir" && has_value) {
+            work_dir = argv[++i];
+        } else if (arg == "--output" && has_value) {
+            output_path = argv[++i];
+        } else if (arg == "--no-caps") {
+            caps = false;
+        } else if (arg == "--list") {
+            for (const auto& engine : engines) printf("%s\n", engine.name.c_str());
+            return 0;
+        } else {
+            fprintf(stderr, "unknown option %s\n", arg.c_str());
+            return 1;
+        }
+    }
+    if (profiles.empty()) {
+        profiles = {Profile::Uniform, Profile::LowEntropy, Profile::Repetitive};
+    }
+    mkdir(work_dir.c_str(), 0755);
+
+    int fd = 1;
+    if (!output_path.empty()) {
+        fd = open(output_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            perror(output_path.c_str());
+            return 1;
+        }
+    }
+    OutputWriter json(fd);
+    json.write("{\n  \"seed\": ");
+    json.write_int(seed);
+    json.write(",\n  \"results\": [");
+    bool first = true;
+    bool warned = false;
+
+    for (const auto& engine : engines) {
+        if (!engine_names.empty() &&
+            std::find(engine_names.begin(), engine_names.end(), engine.name) == engine_names.end() &&
+            std::find(engine_names.begin(), engine_names.end(), engine.binary) == engine_names.end()) {
+            continue;
+        }
+        string binary = bin_dir + "/" + engine.binary;
+        if (!file_exists(binary)) {
+            fprintf(stderr, "skipping %s: %s not found\n", engine.name.c_str(), binary.c_str());
+            continue;
+        }
+
+        for (Profile profile : profiles) {
+            for (size_t size = min_size; size <= max_size; size *= 10) {
+                if (caps && size > engine.max_size) break;
+
+                // Generate the input once per engine format, profile, size and seed
+                string input = work_dir + "/" + engine.name + "-" + profile_name(profile) + "-" +
+                               std::to_string(size) + "-" + std::to_string(seed) + ".in";
+                string info_path = input + ".info";
+                InputInfo info = {0, 0};
+                FILE* info_file = fopen(info_path.c_str(), "r");
+                if (info_file == nullptr || fscanf(info_file, "%zu %zu", &info.characters, &info.queries) != 2) {
+                    int input_fd = open(input.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+                    {
+                        OutputWriter out(input_fd);
+                        info = engine.write_input(out, size, profile, seed);
+                    }
+                    close(input_fd);
+                    FILE* file = fopen(info_path.c_str(), "w");
+                    fprintf(file, "%zu %zu\n", info.characters, info.queries);
+                    fclose(file);
+                }
+                if (info_file != nullptr) fclose(info_file);
+
+                // Keep the fastest of the runs
+                Run best = {-1, 0, 0, 0, 0, Values(), string()};
+                for (int r = 0; r < repeat; ++r) {
+                    Run run = run_engine(binary, engine.args, input, timeout, work_dir + "/phases.json");
+                    if (r == 0 || run.exit_status != 0 || run.wall_seconds < best.wall_seconds) best = run;
+                    if (run.exit_status != 0) break;
+                }
+                fprintf(stderr, "%-26s %-12s %12zu  %9.4f s  %8ld KB  exit %d\n", engine.name.c_str(),
+                        profile_name(profile), size, best.wall_seconds, best.max_rss_kb, best.exit_status);
+
+                if (best.events.size() < PerfCounters::Events && !warned) {
+                    fprintf(stderr, "some hardware events are unavailable, see /proc/sys/kernel/perf_event_paranoid\n");
+                    warned = true;
+                }
+
+                // Append the result
+                string line;
+                append(line,
+                       "%s\n    {\"engine\": \"%s\", \"profile\": \"%s\", \"size\": %zu, \"queries\": %zu, "
+                       "\"exit_status\": %d, \"wall_seconds\": %.6f, \"user_seconds\": %.6f, "
+                       "\"system_seconds\": %.6f, \"max_rss_kb\": %ld, \"ns_per_char\": %.3f, "
+                       "\"queries_per_second\": %.1f, ",
+                       first ? "" : ",", engine.name.c_str(), profile_name(profile), size, info.queries,
+                       best.exit_status, best.wall_seconds, best.user_seconds, best.system_seconds,
+                       best.max_rss_kb, best.wall_seconds * 1e9 / std::max<size_t>(1, info.characters),
+                       info.queries > 0 ? info.queries / best.wall_seconds : 0.0);
+                append_events(line, best.events, info);
+                if (!best.phases_json.empty()) {
+                    line += ", ";
+                    append_phases(line, best.phases_json, info);
+                }
+                line += "}";
+                json.write(line);
+                first = false;
+            }
+        }
+    }
+    json.write("\n  ]\n}\n");
+    json.flush();
+    if (fd != 1) close(fd);
+    return 0;
+}
@@ -0,0 +1,190 @@
+#ifndef STRINGS_CHALLENGES_DNA_GENERATOR_H
+#define STRINGS_CHALLENGES_DNA_GENERATOR_H
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Seeded synthetic DNA for the benchmarks. The generator does not depend on the
+// standard library distributions, so the same seed produces the same data with
+// any compiler and on any host.
+
+// Shape of the generated text
+enum class Profile {
+    Uniform,     // Independent uniformly distributed letters
+    LowEntropy,  // Long homopolymer runs with a skewed composition
+    Repetitive   // Copies of one founder sequence with few mutations, like strains of a pan-genome
+};
+
+inline const char* profile_name(Profile profile) {
+    switch (profile) {
+        case Profile::Uniform: return "uniform";
+        case Profile::LowEntropy: return "low-entropy";
+        case Profile::Repetitive: return "repetitive";
+    }
+    return "";
+}
+
+inline bool parse_profile(const std::string& name, Profile& profile) {
+    for (Profile p : {Profile::Uniform, Profile::LowEntropy, Profile::Repetitive}) {
+        if (name == profile_name(p)) {
+            profile = p;
+            return true;
+        }
+    }
+    return false;
+}
+
+// SplitMix64 pseudo-random generator
+class Random {
+public:
+    explicit Random(uint64_t seed) : state_(seed) {}
+
+    uint64_t next() {
+        uint64_t z = (state_ += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    // Get a number in [0, bound)
+    uint64_t below(uint64_t bound) {
+        return next() % bound;
+    }
+
+    // Get true with the given probability
+    bool chance(double probability) {
+        return (next() >> 11) * (1.0 / 9007199254740992.0) < probability;
+    }
+
+private:
+    uint64_t state_;
+};
+
+char const Bases[] = "ACGT";
+
+// Generate n letters of DNA with the given profile
+inline std::string generate_dna(size_t n, Profile profile, uint64_t seed) {
+    Random random(seed);
+    std::string text(n, 'A');
+
+    switch (profile) {
+        case Profile::Uniform:
+            for (size_t i = 0; i < n; ++i) {
+                text[i] = Bases[random.next() & 3];
+            }
+            break;
+
+        case Profile::LowEntropy: {
+            // Repeat the previous letter with probability 0.8, otherwise draw from
+            // a composition of 55% A, 25% T, 10% C and 10% G
+            char previous = 'A';
+            for (size_t i = 0; i < n; ++i) {
+                if (i == 0 || !random.chance(0.8)) {
+                    uint64_t r = random.below(20);
+                    previous = r < 11 ? 'A' : r < 16 ? 'T' : r < 18 ? 'C' : 'G';
+                }
+                text[i] = previous;
+            }
+            break;
+        }
+
+        case Profile::Repetitive: {
+            // Every strain is a copy of the founder with 0.1% substitutions
+            size_t founder_size = std::max<size_t>(1, std::min<size_t>(n, 100000));
+            std::string founder = generate_dna(founder_size, Profile::Uniform, seed ^ 0x5EEDULL);
+            for (size_t i = 0; i < n; ++i) {
+                text[i] = random.chance(0.001) ? Bases[random.next() & 3] : founder[i % founder_size];
+            }
+            break;
+        }
+    }
+    return text;
+}
+
+// Sample count reads of the given length from the text, each one with up to
+// max_substitutions random substitutions
+inline std::vector<std::string> sample_reads(const std::string& text, size_t count, size_t length,
+                                             int max_substitutions, uint64_t seed) {
+    Random random(seed);
+    length = std::min(length, text.size());
+    std::vector<std::string> reads(count);
+    for (auto& read : reads) {
+        read = text.substr(random.below(text.size() - length + 1), length);
+        int substitutions = max_substitutions > 0 ? random.below(max_substitutions + 1) : 0;
+        for (int s = 0; s < substitutions && length > 0; ++s) {
+            read[random.below(length)] = Bases[random.next() & 3];
+        }
+    }
+    return reads;
+}
+
+// Build the suffix array of a text ending with the unique smallest symbol '$'
+// by prefix doubling with counting sorts, in O(n log n).
+inline std::vector<int> build_suffix_array(const std::string& text) {
+    int n = text.size();
+    std::vector<int> order(n), classes(n), new_order(n), new_classes(n), count(std::max(n, 256));
+
+    // Sort the single characters
+    for (int i = 0; i < n; ++i) count[(unsigned char)text[i]]++;
+    for (int c = 1; c < 256; ++c) count[c] += count[c - 1];
+    for (int i = n - 1; i >= 0; --i) order[--count[(unsigned char)text[i]]] = i;
+    classes[order[0]] = 0;
+    for (int i = 1; i < n; ++i) {
+        classes[order[i]] = classes[order[i - 1]] + (text[order[i]] != text[order[i - 1]]);
+    }
+
+    // Double the length of the sorted cyclic shifts until all classes are distinct
+    for (int l = 1; l < n && classes[order[n - 1]] < n - 1; l *= 2) {
+        std::fill(count.begin(), count.begin() + n, 0);
+        for (int i = 0; i < n; ++i) count[classes[i]]++;
+        for (int c = 1; c < n; ++c) count[c] += count[c - 1];
+        for (int i = n - 1; i >= 0; --i) {
+            int start = (order[i] - l + n) % n;
+            new_order[--count[classes[start]]] = start;
+        }
+        order.swap(new_order);
+
+        new_classes[order[0]] = 0;
+        for (int i = 1; i < n; ++i) {
+            int cur = order[i], prev = order[i - 1];
+            bool differ = classes[cur] != classes[prev] || classes[(cur + l) % n] != classes[(prev + l) % n];
+            new_classes[cur] = new_classes[prev] + differ;
+        }
+        classes.swap(new_classes);
+    }
+    return order;
+}
+
+// Build the LCP array of adjacent suffixes with Kasai's algorithm:
+// lcp[i] is the longest common prefix of the suffixes at suffix_array[i] and suffix_array[i + 1]
+inline std::vector<int> build_lcp_array(const std::string& text, const std::vector<int>& suffix_array) {
+    int n = text.size();
+    std::vector<int> rank(n), lcp(n > 0 ? n - 1 : 0);
+    for (int i = 0; i < n; ++i) rank[suffix_array[i]] = i;
+    int h = 0;
+    for (int i = 0; i < n; ++i) {
+        if (rank[i] + 1 < n) {
+            int j = suffix_array[rank[i] + 1];
+            while (i + h < n && j + h < n && text[i + h] == text[j + h]) h++;
+            lcp[rank[i]] = h;
+            if (h > 0) h--;
+        } else {
+            h = 0;
+        }
+    }
+    return lcp;
+}
+
+// Get the Burrows-Wheeler transform of a text ending with '$' from its suffix array
+inline std::string build_bwt(const std::string& text, const std::vector<int>& suffix_array) {
+    int n = text.size();
+    std::string bwt(n, ' ');
+    for (int i = 0; i < n; ++i) {
+        bwt[i] = text[(suffix_array[i] + n - 1) % n];
+    }
+    return bwt;
+}
+
+#endif
@@ -0,0 +1,44 @@
+#include <cstdio>
+#include <string>
+
+#include "../common/fast_output.h"
+#include "dna_generator.h"
+
+using std::string;
+
+// Write seeded synthetic DNA to standard output.
+// Usage: gen_dna SIZE [PROFILE] [SEED] [--fasta]
+//   PROFILE is uniform (default), low-entropy or repetitive.
+//   With --fasta, the sequence gets a header and is wrapped at 60 letters per line.
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s SIZE [uniform|low-entropy|repetitive] [SEED] [--fasta]\n", argv[0]);
+        return 1;
+    }
+    size_t size = std::stoull(argv[1]);
+    Profile profile = Profile::Uniform;
+    if (argc > 2 && !parse_profile(argv[2], profile)) {
+        fprintf(stderr, "unknown profile %s\n", argv[2]);
+        return 1;
+    }
+    unsigned long long seed = argc > 3 ? std::stoull(argv[3]) : 1;
+    bool fasta = argc > 4 && string(argv[4]) == "--fasta";
+
+    string text = generate_dna(size, profile, seed);
+    OutputWriter output;
+    if (!fasta) {
+        output.write(text);
+        output.put('\n');
+        return 0;
+    }
+    output.write(">synthetic ");
+    output.write(profile_name(profile));
+    output.write(" seed=");
+    output.write_int(seed);
+    output.put('\n');
+    for (size_t i = 0; i < size; i += 60) {
+        output.write(text.data() + i, std::min<size_t>(60, size - i));
+        output.put('\n');
+    }
+    return 0;
+}
@@ -0,0 +1,100 @@
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "../common/fast_output.h"
+
+using std::string;
+using std::vector;
+
+// Measure how fast each way of writing a list of sorted positions goes,
+// the shape of the results of kmp and suffix_array_matching.
+// Usage: output_bench [count] [path], writes to /dev/null by default.
+
+// Run the writer, which produces the given number of bytes, and print its throughput
+template <typename Writer>
+void measure(const char* name, const char* path, const vector<int>& positions, long long bytes, Writer write) {
+    auto begin = std::chrono::steady_clock::now();
+    write(path, positions);
+    auto end = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(end - begin).count();
+    printf("%-24s %8.3f s %10.1f MB/s %10.1f M positions/s\n", name, seconds,
+           bytes / seconds / 1e6, positions.size() / seconds / 1e6);
+}
+
+int main(int argc, char** argv) {
+    int count = argc > 1 ? std::stoi(argv[1]) : 10000000;
+    const char* path = argc > 2 ? argv[2] : "/dev/null";
+
+    // Sorted positions with gaps similar to frequent matches
+    vector<int> positions(count);
+    unsigned state = 12345;
+    int position = 0;
+    for (int i = 0; i < count; ++i) {
+        state = state * 1103515245 + 12345;
+        position += 1 + (state >> 16) % 64;
+        positions[i] = position;
+    }
+
+    // Get the size of the text output, one separator per position plus the final newline,
+    // and of the binary output, one varint per gap plus the terminator
+    long long text_bytes = 1;
+    long long binary_bytes = 1;
+    int previous = -1;
+    for (int p : positions) {
+        text_bytes += std::to_string(p).size() + 1;
+        for (unsigned gap = p - previous; ; gap >>= 7) {
+            binary_bytes++;
+            if (gap < 0x80) break;
+        }
+        previous = p;
+    }
+
+    measure("fprintf", path, positions, text_bytes, [] (const char* path, const vector<int>& positions) {
+        FILE* file = fopen(path, "w");
+        for (int p : positions) fprintf(file, "%d ", p);
+        fprintf(file, "\n");
+        fclose(file);
+    });
+
+    measure("ofstream endl per line", path, positions, text_bytes - 1, [] (const char* path, const vector<int>& positions) {
+        std::ofstream file(path);
+        for (int p : positions) file << p << std::endl;
+    });
+
+    measure("ofstream", path, positions, text_bytes, [] (const char* path, const vector<int>& positions) {
+        std::ofstream file(path);
+        for (int p : positions) file << p << ' ';
+        file << '\n';
+    });
+
+    measure("OutputWriter text", path, positions, text_bytes, [] (const char* path, const vector<int>& positions) {
+        int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        {
+            OutputWriter output(fd);
+            for (int p : positions) {
+                output.write_int(p);
+                output.put(' ');
+            }
+            output.put('\n');
+        }
+        close(fd);
+    });
+
+    measure("OutputWriter delta varint", path, positions, binary_bytes, [] (const char* path, const vector<int>& positions) {
+        int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        {
+            OutputWriter output(fd);
+            DeltaPositionWriter writer(output);
+            for (int p : positions) writer.add(p);
+            writer.finish();
+        }
+        close(fd);
+    });
+    return 0;
+}
@@ -0,0 +1,171 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "../common/fast_input.h"
+
+using std::string;
+using std::vector;
+
+// Load generator for the engines started with --serve, see common/query_server.h.
+// Every client opens a connection and sends its requests one at a time, each
+// one a line of patterns taken in turn from the patterns read on standard
+// input, and waits for the response before sending the next one. Prints the
+// throughput and the latency percentiles as JSON.
+// Usage: query_load SOCKET [--clients N] [--requests N] [--patterns N] < patterns
+//   --clients N    concurrent connections (default: 8)
+//   --requests N   requests per client (default: 1000)
+//   --patterns N   patterns per request (default: 16)
+
+typedef std::chrono::steady_clock Clock;
+
+// Connect to the server, waiting up to 30 s for it to build its index and listen
+int connect_to(const string& path) {
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    auto deadline = Clock::now() + std::chrono::seconds(30);
+    for (;;) {
+        int connection = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (connection >= 0 && connect(connection, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0) {
+            return connection;
+        }
+        if (connection >= 0) close(connection);
+        if (Clock::now() > deadline) return -1;
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+}
+
+bool write_all(int connection, const string& data) {
+    size_t written = 0;
+    while (written < data.size()) {
+        ssize_t count = write(connection, data.data() + written, data.size() - written);
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) return false;
+        written += count;
+    }
+    return true;
+}
+
+// Read up to the end of the next line
+bool read_line(int connection, string& buffer) {
+    char chunk[1 << 16];
+    size_t end;
+    while ((end = buffer.find('\n')) == string::npos) {
+        ssize_t count = read(connection, chunk, sizeof(chunk));
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) return false;
+        buffer.append(chunk, count);
+    }
+    buffer.erase(0, end + 1);
+    return true;
+}
+
+// Send the requests of one client and record their latencies in microseconds
+bool run_client(int connection, const vector<Span>& patterns, size_t first, int requests,
+                int per_request, vector<double>& latencies) {
+    string line, buffer;
+    size_t next = first;
+    bool ok = true;
+    for (int r = 0; r < requests && ok; ++r) {
+        line.clear();
+        for (int p = 0; p < per_request; ++p) {
+            if (p > 0) line += ' ';
+            const Span& pattern = patterns[next++ % patterns.size()];
+            line.append(pattern.data(), pattern.size());
+        }
+        line += '\n';
+        auto begin = Clock::now();
+        ok = write_all(connection, line) && read_line(connection, buffer);
+        latencies.push_back(std::chrono::duration<double, std::micro>(Clock::now() - begin).count());
+    }
+    close(connection);
+    return ok;
+}
+
+double percentile(const vector<double>& sorted, double fraction) {
+    if (sorted.empty()) return 0;
+    size_t index = std::min(sorted.size() - 1, size_t(fraction * sorted.size()));
+    return sorted[index];
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s SOCKET [--clients N] [--requests N] [--patterns N] < patterns\n", argv[0]);
+        return 1;
+    }
+    string path = argv[1];
+    int clients = 8;
+    int requests = 1000;
+    int per_request = 16;
+    for (int i = 2; i + 1 < argc; i += 2) {
+        string arg = argv[i];
+        if (arg == "--clients") {
+            clients = std::max(1, std::stoi(argv[i + 1]));
+        } else if (arg == "--requests") {
+            requests = std::max(1, std::stoi(argv[i + 1]));
+        } else if (arg == "--patterns") {
+            per_request = std::max(1, std::stoi(argv[i + 1]));
+        }
+    }
+
+    InputReader input;
+    vector<Span> patterns;
+    for (Span pattern = input.next_token(); pattern.size() > 0; pattern = input.next_token()) {
+        patterns.push_back(pattern);
+    }
+    if (patterns.empty()) {
+        fprintf(stderr, "no patterns on standard input\n");
+        return 1;
+    }
+
+    // Connect all the clients before the clock starts
+    vector<int> connections;
+    for (int c = 0; c < clients; ++c) {
+        connections.push_back(connect_to(path));
+        if (connections.back() < 0) {
+            fprintf(stderr, "cannot connect to %s\n", path.c_str());
+            return 1;
+        }
+    }
+
+    // Every client starts at another place of the patterns
+    vector<vector<double>> latencies(clients);
+    vector<char> ok(clients, 0);
+    vector<std::thread> threads;
+    auto begin = Clock::now();
+    for (int c = 0; c < clients; ++c) {
+        threads.emplace_back([&, c] {
+            size_t first = patterns.size() * c / clients;
+            ok[c] = run_client(connections[c], patterns, first, requests, per_request, latencies[c]);
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    double seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+
+    vector<double> all;
+    for (int c = 0; c < clients; ++c) {
+        if (!ok[c]) {
+            fprintf(stderr, "client %d could not complete its requests\n", c);
+            return 1;
+        }
+        all.insert(all.end(), latencies[c].begin(), latencies[c].end());
+    }
+    std::sort(all.begin(), all.end());
+    printf("{\"clients\": %d, \"requests\": %zu, \"patterns_per_request\": %d, \"seconds\": %.6f, "
+           "\"requests_per_second\": %.1f, \"patterns_per_second\": %.1f, "
+           "\"p50_us\": %.1f, \"p99_us\": %.1f, \"max_us\": %.1f}\n",
+           clients, all.size(), per_request, seconds, all.size() / seconds, all.size() * per_request / seconds,
+           percentile(all, 0.5), percentile(all, 0.99), all.back());
+    return 0;
+}
@@ -0,0 +1,198 @@
+#ifndef STRINGS_CHALLENGES_ARENA_H
+#define STRINGS_CHALLENGES_ARENA_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <list>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <sys/mman.h>
+
+// Monotonic arena for the nodes of the trie and suffix tree builders. Memory
+// is handed out by bumping a pointer through large blocks mapped from the
+// kernel, individual deallocations do nothing, and every block is released at
+// once when the arena is destroyed. With huge pages the blocks are 2 MB
+// aligned multiples, mapped from the hugetlb pool when it has pages and
+// advised for transparent huge pages otherwise. An arena is used by one
+// thread at a time; each worker thread gets its own from sub_arena().
+class Arena {
+public:
+    static size_t const FirstBlock = 1 << 16;
+    static size_t const LargestBlock = 1 << 24;
+    static size_t const HugePage = 1 << 21;
+
+    // Huge pages are used when the environment variable STRINGS_HUGE_PAGES is set
+    static bool huge_pages_requested() {
+        return getenv("STRINGS_HUGE_PAGES") != nullptr;
+    }
+
+    explicit Arena(bool huge_pages = huge_pages_requested())
+        : huge_pages_(huge_pages), next_(nullptr), end_(nullptr),
+          next_block_(huge_pages ? HugePage : FirstBlock), allocated_(0) {}
+
+    ~Arena() {
+        for (const auto& block : blocks_) {
+            munmap(block.first, block.second);
+        }
+    }
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // Get bytes of memory aligned to alignment, a power of two
+    void* allocate(size_t bytes, size_t alignment) {
+        uintptr_t start = (reinterpret_cast<uintptr_t>(next_) + alignment - 1) & ~uintptr_t(alignment - 1);
+        if (next_ == nullptr || start + bytes > reinterpret_cast<uintptr_t>(end_)) {
+            // Requests as large as a block get a block of their own,
+            // so the rest of the current block is not wasted
+            if (bytes + alignment > next_block_ / 2) {
+                allocated_ += bytes;
+                return map_block(bytes + alignment, alignment);
+            }
+
+            // Otherwise continue in a new block, twice as large as the previous one
+            char* block = static_cast<char*>(map_block(next_block_, 1));
+            end_ = block + next_block_;
+            next_block_ = std::min(next_block_ * 2, LargestBlock);
+            start = (reinterpret_cast<uintptr_t>(block) + alignment - 1) & ~uintptr_t(alignment - 1);
+        }
+        next_ = reinterpret_cast<char*>(start + bytes);
+        allocated_ += bytes;
+        return reinterpret_cast<void*>(start);
+    }
+
+    // Create an arena for another thread, released together with this one
+    Arena& sub_arena() {
+        std::lock_guard<std::mutex> lock(children_mutex_);
+        children_.emplace_back(huge_pages_);
+        return children_.back();
+    }
+
+    // Bytes handed out and bytes mapped, including the sub-arenas
+    size_t allocated() const {
+        size_t total = allocated_;
+        for (const auto& child : children_) total += child.allocated();
+        return total;
+    }
+
+    size_t reserved() const {
+        size_t total = 0;
+        for (const auto& block : blocks_) total += block.second;
+        for (const auto& child : children_) total += child.reserved();
+        return total;
+    }
+
+    // Arena that default-constructed ArenaAllocators of this thread take
+    // their memory from, nullptr for the global heap. Set with ArenaScope.
+    static Arena*& current() {
+        static thread_local Arena* arena = nullptr;
+        return arena;
+    }
+
+private:
+    void* map_block(size_t bytes, size_t alignment) {
+        if (huge_pages_) bytes = (bytes + HugePage - 1) & ~(HugePage - 1);
+        void* block = MAP_FAILED;
+#ifdef MAP_HUGETLB
+        if (huge_pages_) {
+            block = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        }
+#endif
+        if (block == MAP_FAILED) {
+            block = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (block == MAP_FAILED) throw std::bad_alloc();
+#ifdef MADV_HUGEPAGE
+            if (huge_pages_) madvise(block, bytes, MADV_HUGEPAGE);
+#endif
+        }
+        blocks_.push_back(std::make_pair(block, bytes));
+        uintptr_t start = (reinterpret_cast<uintptr_t>(block) + alignment - 1) & ~uintptr_t(alignment - 1);
+        return reinterpret_cast<void*>(start);
+    }
+
+    bool huge_pages_;
+    char* next_;
+    char* end_;
+    size_t next_block_;
+    size_t allocated_;
+    std::vector<std::pair<void*, size_t>> blocks_;
+    std::mutex children_mutex_;
+    std::list<Arena> children_;
+};
+
+// Make the containers created by this thread within the scope allocate from
+// an arena, or from the global heap when the arena is nullptr
+class ArenaScope {
+public:
+    explicit ArenaScope(Arena* arena) : previous_(Arena::current()) {
+        Arena::current() = arena;
+    }
+
+    explicit ArenaScope(Arena& arena) : ArenaScope(&arena) {}
+
+    ~ArenaScope() {
+        Arena::current() = previous_;
+    }
+
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+
+private:
+    Arena* previous_;
+};
+
+// Standard allocator adapter over an arena. A default-constructed allocator
+// takes the current arena of the thread, so containers built inside an
+// ArenaScope need no other change; copies keep allocating from that arena
+// wherever they are used later.
+template <typename T>
+class ArenaAllocator {
+public:
+    typedef T value_type;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+
+    ArenaAllocator() noexcept : arena_(Arena::current()) {}
+    explicit ArenaAllocator(Arena* arena) noexcept : arena_(arena) {}
+
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) noexcept : arena_(other.arena()) {}
+
+    T* allocate(size_t n) {
+        if (arena_ == nullptr) return static_cast<T*>(::operator new(n * sizeof(T)));
+        return static_cast<T*>(arena_->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* pointer, size_t) noexcept {
+        if (arena_ == nullptr) ::operator delete(pointer);
+    }
+
+    Arena* arena() const noexcept {
+        return arena_;
+    }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const noexcept {
+        return arena_ == other.arena();
+    }
+
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const noexcept {
+        return arena_ != other.arena();
+    }
+
+private:
+    Arena* arena_;
+};
+
+// Vector whose buffer comes from the current arena
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+#endif
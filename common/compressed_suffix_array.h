@@ -0,0 +1,165 @@
+#ifndef STRINGS_CHALLENGES_COMPRESSED_SUFFIX_ARRAY_H
+#define STRINGS_CHALLENGES_COMPRESSED_SUFFIX_ARRAY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "elias_fano.h"
+#include "rank_bit_vector.h"
+
+// Compressed suffix array of a text ending with a unique '$', replacing both
+// the text and the suffix array. It stores
+//   - Psi, where Psi(i) is the row of the suffix one position after the
+//     suffix of row i. Psi increases over the rows starting with the same
+//     character, so adding c n to the rows of the c-th character makes it a
+//     non-decreasing sequence, coded with Elias-Fano in about 5 bits per
+//     character for DNA.
+//   - The first row of every character, so the first character of the
+//     suffix at any row is known, and the next ones are read through Psi.
+//   - The suffix array at the rows of the positions multiple of the sample
+//     step, marked in a bit vector, and the inverse suffix array at those
+//     positions.
+// Locating a row follows Psi up to a sampled row, at most step - 1 times,
+// and extracting the text from a position starts at the sampled row before it.
+//
+// Rows and positions are ints, like the suffix array it is built from, so
+// texts are limited to MaxLength characters, '$' included; the constructor
+// throws std::length_error beyond. Building holds the text, the suffix array
+// and the full inverse suffix array at once, about 9n bytes on top of the
+// index, so the index saves memory for the queries but not for its build.
+class CompressedSuffixArray {
+public:
+    static size_t const MaxLength = std::numeric_limits<int>::max();
+
+    CompressedSuffixArray() : n_(0), step_(1), end_row_(0) {}
+
+    CompressedSuffixArray(const std::string& text, const std::vector<int>& suffix_array, int step)
+        : n_(checked_length(text.size())), step_(step), sampled_(text.size()) {
+        // Characters of the text and the first row of each
+        std::vector<int> counts(256, 0);
+        for (unsigned char c : text) counts[c]++;
+        for (int c = 0, row = 0; c < 256; ++c) {
+            if (counts[c] == 0) continue;
+            symbols_.push_back(c);
+            starts_.push_back(row);
+            row += counts[c];
+        }
+        starts_.push_back(n_);
+
+        std::vector<int> inverse(n_);
+        for (int i = 0; i < n_; ++i) inverse[suffix_array[i]] = i;
+        end_row_ = inverse[n_ - 1];
+        psi_ = EliasFano(ShiftedPsi{this, suffix_array, inverse}, uint64_t(symbols_.size()) * n_);
+
+        for (int i = 0; i < n_; ++i) {
+            if (suffix_array[i] % step_ == 0) sampled_.set(i);
+        }
+        sampled_.build_rank();
+        suffix_samples_.resize(n_ / step_ + (n_ % step_ != 0));
+        inverse_samples_.resize(suffix_samples_.size());
+        for (int i = 0; i < n_; ++i) {
+            if (suffix_array[i] % step_ == 0) {
+                suffix_samples_[sampled_.rank1(i)] = suffix_array[i];
+                inverse_samples_[suffix_array[i] / step_] = i;
+            }
+        }
+    }
+
+    int size() const {
+        return n_;
+    }
+
+    // Index of the first character of the suffix at row i in symbols_
+    int symbol_index(int i) const {
+        int c = 0;
+        while (starts_[c + 1] <= i) c++;
+        return c;
+    }
+
+    // Row of the suffix one position after the suffix of row i
+    int psi(int i) const {
+        return psi_[i] - uint64_t(symbol_index(i)) * n_;
+    }
+
+    // Compare the suffix at row i with pattern[start, start + m): negative if
+    // the suffix is smaller, positive if it is larger, 0 if it starts with the
+    // pattern or is a prefix of it.
+    template <typename Pattern>
+    int compare(int i, const Pattern& pattern, int start, int m) const {
+        for (int j = 0; j < m; ++j) {
+            int c = symbol_index(i);
+            unsigned char letter = pattern[start + j];
+            if (symbols_[c] != letter) return symbols_[c] < letter ? -1 : 1;
+            if (i == end_row_) return 0;
+            i = psi_[i] - uint64_t(c) * n_;
+        }
+        return 0;
+    }
+
+    // Position in the text of the suffix at row i
+    int locate(int i) const {
+        int steps = 0;
+        while (!sampled_.get(i)) {
+            i = psi(i);
+            steps++;
+        }
+        int position = suffix_samples_[sampled_.rank1(i)] - steps;
+        return position < 0 ? position + n_ : position;
+    }
+
+    // Copy the length characters of the text from position into out
+    void extract(int position, int length, char* out) const {
+        int i = inverse_samples_[position / step_];
+        for (int k = position % step_; k > 0; --k) i = psi(i);
+        for (int j = 0; j < length; ++j) {
+            int c = symbol_index(i);
+            out[j] = symbols_[c];
+            i = psi_[i] - uint64_t(c) * n_;
+        }
+    }
+
+    // Memory taken by the index
+    size_t bytes() const {
+        return psi_.bytes() + sampled_.bytes() + (suffix_samples_.size() + inverse_samples_.size()) * sizeof(int)
+            + symbols_.size() + starts_.size() * sizeof(int);
+    }
+
+private:
+    static int checked_length(size_t length) {
+        if (length > MaxLength) throw std::length_error("text too long for a compressed suffix array");
+        return length;
+    }
+
+    // Psi computed from the suffix array, shifted up by c n for the rows of
+    // the c-th character, read once by the Elias-Fano coding
+    struct ShiftedPsi {
+        const CompressedSuffixArray* csa;
+        const std::vector<int>& suffix_array;
+        const std::vector<int>& inverse;
+
+        size_t size() const {
+            return suffix_array.size();
+        }
+
+        uint64_t operator[](int i) const {
+            int next = suffix_array[i] + 1 == csa->n_ ? 0 : suffix_array[i] + 1;
+            return uint64_t(csa->symbol_index(i)) * csa->n_ + inverse[next];
+        }
+    };
+
+    int n_;
+    int step_;
+    int end_row_;                        // Row of the suffix "$"
+    std::vector<unsigned char> symbols_; // Characters of the text, in order
+    std::vector<int> starts_;            // First row of every character, then n
+    EliasFano psi_;
+    RankBitVector sampled_;              // Rows whose suffix array value is a multiple of step
+    std::vector<int> suffix_samples_;    // Suffix array at the sampled rows, in row order
+    std::vector<int> inverse_samples_;   // Row of the positions 0, step, 2 step...
+};
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef STRINGS_CHALLENGES_ELIAS_FANO_H
+#define STRINGS_CHALLENGES_ELIAS_FANO_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "rank_bit_vector.h"
+
+// Non-decreasing sequence of n integers below a universe u in about
+// 2 + log2(u / n) bits each, with random access. Every value is split into
+// its low bits, stored as they are, and its high bits, stored in unary: the
+// value i sets bit (high_i + i) of a bit vector, so it is read back by
+// finding the i-th one. The position of every SelectStep-th one is sampled,
+// so finding a one scans a word or two from the closest sample.
+class EliasFano {
+public:
+    EliasFano() : n_(0), low_bits_(0) {}
+
+    template <typename Values>
+    EliasFano(const Values& values, uint64_t universe) : n_(values.size()), low_bits_(0) {
+        while (n_ > 0 && (uint64_t(n_) << (low_bits_ + 1)) <= universe) low_bits_++;
+        low_.assign((uint64_t(n_) * low_bits_ + 63) / 64 + 1, 0);
+        high_.assign(((universe >> low_bits_) + n_) / 64 + 2, 0);
+
+        uint64_t mask = (uint64_t(1) << low_bits_) - 1;
+        for (size_t i = 0; i < n_; ++i) {
+            uint64_t value = values[i];
+            if (low_bits_ > 0) {
+                uint64_t bit = uint64_t(i) * low_bits_;
+                low_[bit / 64] |= (value & mask) << (bit % 64);
+                if (bit % 64 + low_bits_ > 64) low_[bit / 64 + 1] |= (value & mask) >> (64 - bit % 64);
+            }
+            uint64_t one = (value >> low_bits_) + i;
+            high_[one / 64] |= uint64_t(1) << (one % 64);
+            if (i % SelectStep == 0) select_samples_.push_back(one);
+        }
+    }
+
+    size_t size() const {
+        return n_;
+    }
+
+    // Value at index i
+    uint64_t operator[](size_t i) const {
+        uint64_t low = 0;
+        if (low_bits_ > 0) {
+            uint64_t bit = uint64_t(i) * low_bits_;
+            low = low_[bit / 64] >> (bit % 64);
+            if (bit % 64 + low_bits_ > 64) low |= low_[bit / 64 + 1] << (64 - bit % 64);
+            low &= (uint64_t(1) << low_bits_) - 1;
+        }
+        return ((select_high(i) - i) << low_bits_) | low;
+    }
+
+    // Memory taken by the sequence
+    size_t bytes() const {
+        return (low_.size() + high_.size() + select_samples_.size()) * sizeof(uint64_t);
+    }
+
+private:
+    static int const SelectStep = 128;
+
+    // Position of the i-th one of the high bits, counting from 0
+    uint64_t select_high(size_t i) const {
+        uint64_t position = select_samples_[i / SelectStep];
+        size_t left = i % SelectStep;
+        size_t word = position / 64;
+
+        // Ones of the sampled word from the sample on, then whole words
+        uint64_t bits = high_[word] & (~uint64_t(0) << (position % 64));
+        for (;;) {
+            size_t ones = popcount64(bits);
+            if (left < ones) break;
+            left -= ones;
+            bits = high_[++word];
+        }
+        return word * 64 + select_in_word(bits, left);
+    }
+
+    // Position of the k-th one of a word with more than k ones. The bytes are
+    // counted in parallel to find the byte holding it, then its bits one by one.
+    static int select_in_word(uint64_t x, size_t k) {
+        uint64_t counts = x - ((x >> 1) & 0x5555555555555555ULL);
+        counts = (counts & 0x3333333333333333ULL) + ((counts >> 2) & 0x3333333333333333ULL);
+        counts = (counts + (counts >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+        uint64_t before = counts * 0x0101010101010101ULL;       // Byte b: ones in bytes [0, b]
+        int byte = 0;
+        while (((before >> (8 * byte)) & 0xff) <= k) byte++;
+        if (byte > 0) k -= (before >> (8 * (byte - 1))) & 0xff;
+        uint64_t bits = (x >> (8 * byte)) & 0xff;
+        for (; k > 0; --k) bits &= bits - 1;
+        return 8 * byte + __builtin_ctzll(bits);
+    }
+
+    size_t n_;
+    int low_bits_;
+    std::vector<uint64_t> low_;
+    std::vector<uint64_t> high_;
+    std::vector<uint64_t> select_samples_;  // Position of the ones 0, SelectStep, 2 SelectStep...
+};
+
+#endif
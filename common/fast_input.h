@@ -0,0 +1,155 @@
+#ifndef STRINGS_CHALLENGES_FAST_INPUT_H
+#define STRINGS_CHALLENGES_FAST_INPUT_H
+
+#include <cstddef>
+#include <list>
+#include <string>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "instrument.h"
+
+// Read-only view of a range of characters owned by someone else,
+// with the subset of the std::string interface the engines use.
+struct Span {
+    const char* ptr;
+    size_t length;
+
+    Span() : ptr(nullptr), length(0) {}
+    Span(const char* ptr_, size_t length_) : ptr(ptr_), length(length_) {}
+    Span(const std::string& s) : ptr(s.data()), length(s.size()) {}
+
+    const char* data() const { return ptr; }
+    size_t size() const { return length; }
+    bool empty() const { return length == 0; }
+    char operator[](size_t i) const { return ptr[i]; }
+    const char* begin() const { return ptr; }
+    const char* end() const { return ptr + length; }
+
+    // Copy the characters into an owning string
+    std::string str() const { return std::string(ptr, length); }
+};
+
+// Input shared by all the engines. Standard input is memory-mapped when it is
+// redirected from a regular file, and read into a single buffer otherwise, so
+// tokens are handed out as spans into the input without copying them.
+class InputReader {
+public:
+    // Map or read the whole input of the file descriptor, standard input by default
+    explicit InputReader(int fd = 0) : data_(nullptr), size_(0), pos_(0), mapped_(false) {
+        STRINGS_PHASE("input");
+        struct stat info;
+        if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+            void* address = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (address != MAP_FAILED) {
+                madvise(address, info.st_size, MADV_SEQUENTIAL);
+                data_ = static_cast<const char*>(address);
+                size_ = info.st_size;
+                mapped_ = true;
+                return;
+            }
+        }
+
+        // Pipes, terminals and empty files: read everything into a buffer
+        char chunk[1 << 16];
+        ssize_t count;
+        while ((count = read(fd, chunk, sizeof(chunk))) > 0) {
+            buffer_.append(chunk, count);
+        }
+        data_ = buffer_.data();
+        size_ = buffer_.size();
+    }
+
+    ~InputReader() {
+        if (mapped_) munmap(const_cast<char*>(data_), size_);
+    }
+
+    InputReader(const InputReader&) = delete;
+    InputReader& operator=(const InputReader&) = delete;
+
+    // Check if only whitespace is left
+    bool at_end() {
+        skip_whitespace();
+        return pos_ == size_;
+    }
+
+    // Get the next whitespace-separated token, empty at the end of the input
+    Span next_token() {
+        skip_whitespace();
+        size_t start = pos_;
+        while (pos_ < size_ && !is_whitespace(data_[pos_])) pos_++;
+        return Span(data_ + start, pos_ - start);
+    }
+
+    // Get the next token as an integer. Digits are accumulated by hand,
+    // without the locale and stream machinery of scanf and cin.
+    long long next_int() {
+        skip_whitespace();
+        bool negative = pos_ < size_ && data_[pos_] == '-';
+        if (negative) pos_++;
+        long long value = 0;
+        while (pos_ < size_ && unsigned(data_[pos_] - '0') < 10) {
+            value = value * 10 + (data_[pos_++] - '0');
+        }
+        return negative ? -value : value;
+    }
+
+    // Get the next sequence: a FASTA record when the input is at a '>' header,
+    // or the next token of plain text otherwise. The header line is skipped and
+    // the line breaks of the record are only stripped when it spans several
+    // lines, in which case the joined copy lives as long as the reader.
+    Span next_sequence() {
+        skip_whitespace();
+        if (pos_ == size_ || data_[pos_] != '>') return next_token();
+
+        // Skip the header line
+        while (pos_ < size_ && data_[pos_] != '\n') pos_++;
+
+        // Collect the lines of the record until the next header
+        skip_whitespace();
+        if (pos_ == size_ || data_[pos_] == '>') return Span(data_ + pos_, 0);
+        Span first = next_line();
+        std::string* joined = nullptr;
+        for (;;) {
+            skip_whitespace();
+            if (pos_ == size_ || data_[pos_] == '>') break;
+            Span line = next_line();
+            if (joined == nullptr) {
+                joined_.push_back(first.str());
+                joined = &joined_.back();
+            }
+            joined->append(line.data(), line.size());
+        }
+        return joined == nullptr ? first : Span(*joined);
+    }
+
+private:
+    static bool is_whitespace(char c) {
+        return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+    }
+
+    void skip_whitespace() {
+        while (pos_ < size_ && is_whitespace(data_[pos_])) pos_++;
+    }
+
+    // Get the rest of the current line without its trailing whitespace
+    Span next_line() {
+        skip_whitespace();
+        size_t start = pos_;
+        while (pos_ < size_ && data_[pos_] != '\n') pos_++;
+        size_t end = pos_;
+        while (end > start && is_whitespace(data_[end - 1])) end--;
+        return Span(data_ + start, end - start);
+    }
+
+    const char* data_;
+    size_t size_;
+    size_t pos_;
+    bool mapped_;
+    std::string buffer_;
+    std::list<std::string> joined_;
+};
+
+#endif
@@ -0,0 +1,137 @@
+#ifndef STRINGS_CHALLENGES_FAST_OUTPUT_H
+#define STRINGS_CHALLENGES_FAST_OUTPUT_H
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "instrument.h"
+
+// Output shared by all the engines. Everything is formatted by hand into a
+// large buffer, which is written to the file descriptor only when it fills up
+// and when the writer is destroyed, never once per line. The engines do not
+// check their output, so a failed write, a full disk or a closed pipe, ends
+// the process with status 1 instead of leaving it truncated.
+class OutputWriter {
+public:
+    // Write to the file descriptor, standard output by default
+    explicit OutputWriter(int fd = 1, size_t capacity = 1 << 20) : fd_(fd), buffer_(capacity), used_(0) {}
+
+    ~OutputWriter() {
+        flush();
+    }
+
+    OutputWriter(const OutputWriter&) = delete;
+    OutputWriter& operator=(const OutputWriter&) = delete;
+
+    void put(char c) {
+        if (used_ == buffer_.size()) flush();
+        buffer_[used_++] = c;
+    }
+
+    void write(const char* s, size_t n) {
+        // Large strings skip the buffer
+        if (n > buffer_.size() - used_) {
+            flush();
+            if (n >= buffer_.size()) {
+                write_all(s, n);
+                return;
+            }
+        }
+        memcpy(&buffer_[used_], s, n);
+        used_ += n;
+    }
+
+    void write(const std::string& s) {
+        write(s.data(), s.size());
+    }
+
+    // Write an integer in decimal
+    void write_int(long long value) {
+        // Enough room for the sign and the 20 digits of the largest magnitude
+        if (buffer_.size() - used_ < 21) flush();
+        unsigned long long magnitude = value;
+        if (value < 0) {
+            buffer_[used_++] = '-';
+            magnitude = 0 - magnitude;
+        }
+
+        // Write the digits backwards into a scratch array and copy them in order
+        char digits[20];
+        int count = 0;
+        do {
+            digits[count++] = '0' + magnitude % 10;
+            magnitude /= 10;
+        } while (magnitude != 0);
+        while (count > 0) {
+            buffer_[used_++] = digits[--count];
+        }
+    }
+
+    // Write an unsigned integer as a LEB128 varint: 7 bits per byte,
+    // with the high bit set on every byte except the last one
+    void write_varint(unsigned long long value) {
+        if (buffer_.size() - used_ < 10) flush();
+        while (value >= 0x80) {
+            buffer_[used_++] = char(value | 0x80);
+            value >>= 7;
+        }
+        buffer_[used_++] = char(value);
+    }
+
+    void flush() {
+        STRINGS_PHASE("output");
+        write_all(buffer_.data(), used_);
+        used_ = 0;
+    }
+
+private:
+    void write_all(const char* s, size_t n) {
+        while (n > 0) {
+            ssize_t written = ::write(fd_, s, n);
+            if (written < 0 && errno == EINTR) continue;
+            if (written <= 0) {
+                fprintf(stderr, "cannot write the output: %s\n", written < 0 ? strerror(errno) : "nothing written");
+                exit(1);
+            }
+            s += written;
+            n -= written;
+        }
+    }
+
+    int fd_;
+    std::vector<char> buffer_;
+    size_t used_;
+};
+
+// Binary encoding of a strictly increasing list of positions for downstream tools.
+// Each position is written as the varint of its gap to the previous one, with the
+// previous position of the first one being -1, so every gap is at least 1 and
+// the list is terminated by a 0 byte.
+class DeltaPositionWriter {
+public:
+    explicit DeltaPositionWriter(OutputWriter& out) : out_(out), previous_(-1) {}
+
+    void add(long long position) {
+        out_.write_varint(position - previous_);
+        previous_ = position;
+    }
+
+    // Terminate the list, the writer can be reused for the next one
+    void finish() {
+        out_.write_varint(0);
+        previous_ = -1;
+    }
+
+private:
+    OutputWriter& out_;
+    long long previous_;
+};
+
+#endif
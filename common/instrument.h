@@ -0,0 +1,277 @@
+#ifndef STRINGS_CHALLENGES_INSTRUMENT_H
+#define STRINGS_CHALLENGES_INSTRUMENT_H
+
+// Hot-path instrumentation of the engines, switched at compile time.
+//
+//   STRINGS_PHASE("name");       times the enclosing scope and counts the bytes it allocates
+//   STRINGS_COUNT(name, amount); adds amount to the counter name
+//
+// Without STRINGS_INSTRUMENT both macros expand to nothing, so the engines
+// compile exactly as if they were not there. With it, a JSON summary of the
+// phases and counters is written at exit to the file named by the environment
+// variable STRINGS_INSTRUMENT_OUTPUT, or to standard error. Phases also sum
+// the hardware events of common/perf_counters.h that the machine exposes, so
+// keep them around loops rather than inside them: each phase reads the
+// counters with a few system calls.
+//
+// The instrumented build replaces the global operator new and delete to count
+// allocations, so this header must be included by a single translation unit of
+// each binary, which is the case for every engine.
+
+#ifndef STRINGS_INSTRUMENT
+
+#define STRINGS_PHASE(name)
+#define STRINGS_COUNT(name, amount)
+
+#else
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <new>
+#include <string>
+
+#include "perf_counters.h"
+
+#define STRINGS_CONCAT_IMPL(a, b) a##b
+#define STRINGS_CONCAT(a, b) STRINGS_CONCAT_IMPL(a, b)
+
+#define STRINGS_PHASE(name) \
+    static ::instrument::Phase& STRINGS_CONCAT(strings_phase_, __LINE__) = ::instrument::phase(name); \
+    ::instrument::ScopedPhase STRINGS_CONCAT(strings_scope_, __LINE__)(STRINGS_CONCAT(strings_phase_, __LINE__))
+
+#define STRINGS_COUNT(name, amount) \
+    do { \
+        static std::atomic<long long>& strings_counter = ::instrument::counter(#name); \
+        strings_counter.fetch_add(amount, std::memory_order_relaxed); \
+    } while (0)
+
+namespace instrument {
+
+// Bytes and calls of operator new since the start of the process
+inline std::atomic<long long>& allocated_bytes() {
+    static std::atomic<long long> bytes(0);
+    return bytes;
+}
+
+inline std::atomic<long long>& allocations() {
+    static std::atomic<long long> count(0);
+    return count;
+}
+
+// Totals of every run of a phase. Nested phases are inclusive: the time and
+// allocations of an inner phase also count for the phases around it.
+struct Phase {
+    std::string name;
+    std::atomic<long long> calls;
+    std::atomic<long long> nanoseconds;
+    std::atomic<long long> bytes;
+    std::atomic<long long> allocations;
+    std::atomic<long long> events[PerfCounters::Events];
+
+    explicit Phase(const char* name_) : name(name_), calls(0), nanoseconds(0), bytes(0), allocations(0) {
+        for (auto& count : events) count = 0;
+    }
+};
+
+struct Counter {
+    std::string name;
+    std::atomic<long long> value;
+
+    explicit Counter(const char* name_) : name(name_), value(0) {}
+};
+
+// Phases and counters in order of first use, written as JSON when the process
+// exits. Worker threads may reach the sites of a phase or counter at the same
+// time, so registration takes a lock.
+class Registry {
+public:
+    Registry() : start_(std::chrono::steady_clock::now()) {
+        perf_.open(0, false);
+    }
+
+    ~Registry() {
+        double total = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+        uint64_t events[PerfCounters::Events];
+        perf_.read(events);
+        const char* path = getenv("STRINGS_INSTRUMENT_OUTPUT");
+        FILE* file = path != nullptr ? fopen(path, "w") : nullptr;
+        FILE* out = file != nullptr ? file : stderr;
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        fprintf(out, "{\"binary\": \"%s\", \"total_seconds\": %.6f, \"allocated_bytes\": %lld, \"allocations\": %lld,\n",
+                binary_name(), total, allocated_bytes().load(), allocations().load());
+        for (int e = 0; e < PerfCounters::Events; ++e) {
+            if (perf_.available(e)) fprintf(out, " \"%s\": %llu,", PerfCounters::name(e), (unsigned long long)events[e]);
+        }
+        fprintf(out, "\n \"phases\": [");
+        for (size_t i = 0; i < phases_.size(); ++i) {
+            const Phase& p = phases_[i];
+            fprintf(out, "%s\n  {\"name\": \"%s\", \"calls\": %lld, \"seconds\": %.6f, \"allocated_bytes\": %lld, \"allocations\": %lld",
+                    i == 0 ? "" : ",", p.name.c_str(), p.calls.load(), p.nanoseconds.load() * 1e-9,
+                    p.bytes.load(), p.allocations.load());
+            for (int e = 0; e < PerfCounters::Events; ++e) {
+                if (perf_.available(e)) fprintf(out, ", \"%s\": %lld", PerfCounters::name(e), p.events[e].load());
+            }
+            fprintf(out, "}");
+        }
+        fprintf(out, "],\n \"counters\": {");
+        for (size_t i = 0; i < counters_.size(); ++i) {
+            fprintf(out, "%s\"%s\": %lld", i == 0 ? "" : ", ", counters_[i].name.c_str(), counters_[i].value.load());
+        }
+        fprintf(out, "}}\n");
+        if (file != nullptr) fclose(file);
+    }
+
+    const PerfCounters& perf() const {
+        return perf_;
+    }
+
+    Phase& phase(const char* name) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& p : phases_) {
+            if (p.name == name) return p;
+        }
+        phases_.emplace_back(name);
+        return phases_.back();
+    }
+
+    std::atomic<long long>& counter(const char* name) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& c : counters_) {
+            if (c.name == name) return c.value;
+        }
+        counters_.emplace_back(name);
+        return counters_.back().value;
+    }
+
+private:
+    static const char* binary_name() {
+#ifdef __GLIBC__
+        return program_invocation_short_name;
+#else
+        return "";
+#endif
+    }
+
+    std::chrono::steady_clock::time_point start_;
+    PerfCounters perf_;
+    std::mutex mutex_;
+    std::deque<Phase> phases_;
+    std::deque<Counter> counters_;
+};
+
+inline Registry& registry() {
+    static Registry instance;
+    return instance;
+}
+
+namespace {
+
+// Creates the registry during static initialization, so total_seconds also
+// covers what runs before the first phase, such as reading the input
+struct RegistryStart {
+    RegistryStart() {
+        registry();
+    }
+};
+
+const RegistryStart registry_start;
+
+}  // namespace
+
+// Call sites cache the result in a static, so the lookup happens once per site
+inline Phase& phase(const char* name) {
+    return registry().phase(name);
+}
+
+inline std::atomic<long long>& counter(const char* name) {
+    return registry().counter(name);
+}
+
+// Adds the time and allocations of its lifetime to a phase
+class ScopedPhase {
+public:
+    explicit ScopedPhase(Phase& phase)
+        : phase_(phase), start_(std::chrono::steady_clock::now()),
+          bytes_(allocated_bytes().load()), allocations_(allocations().load()) {
+        registry().perf().read(events_);
+    }
+
+    ~ScopedPhase() {
+        uint64_t events[PerfCounters::Events];
+        registry().perf().read(events);
+        for (int e = 0; e < PerfCounters::Events; ++e) {
+            phase_.events[e] += events[e] - events_[e];
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start_;
+        phase_.calls++;
+        phase_.nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+        phase_.bytes += allocated_bytes().load() - bytes_;
+        phase_.allocations += allocations().load() - allocations_;
+    }
+
+    ScopedPhase(const ScopedPhase&) = delete;
+    ScopedPhase& operator=(const ScopedPhase&) = delete;
+
+private:
+    Phase& phase_;
+    std::chrono::steady_clock::time_point start_;
+    long long bytes_;
+    long long allocations_;
+    uint64_t events_[PerfCounters::Events];
+};
+
+}  // namespace instrument
+
+namespace instrument {
+
+// Every replacement operator below allocates and releases through these two,
+// kept out of line so the compiler pairs the operators with each other, not
+// the free of a delete with the operator new it was inlined against
+__attribute__((noinline)) inline void* allocate(size_t size) {
+    allocated_bytes().fetch_add(size, std::memory_order_relaxed);
+    allocations().fetch_add(1, std::memory_order_relaxed);
+    void* pointer = malloc(size == 0 ? 1 : size);
+    if (pointer == nullptr) throw std::bad_alloc();
+    return pointer;
+}
+
+__attribute__((noinline)) inline void release(void* pointer) noexcept {
+    free(pointer);
+}
+
+}  // namespace instrument
+
+// Count every allocation of the binary
+void* operator new(size_t size) {
+    return instrument::allocate(size);
+}
+
+void* operator new[](size_t size) {
+    return instrument::allocate(size);
+}
+
+void operator delete(void* pointer) noexcept {
+    instrument::release(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+    instrument::release(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    instrument::release(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept {
+    instrument::release(pointer);
+}
+
+#endif
+
+#endif
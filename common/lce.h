@@ -0,0 +1,106 @@
+#ifndef STRINGS_CHALLENGES_LCE_H
+#define STRINGS_CHALLENGES_LCE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "enhanced_suffix_array.h"
+
+// Longest common extension of any two suffixes of a text, the length of
+// their longest common prefix, without reading the text. The suffixes at
+// positions i and j sit at rows rank(i) < rank(j) of the suffix array, and
+// their LCE is the minimum of the LCP array over the rows (rank(i), rank(j)].
+//
+// The minimum is found with a sparse table over the minima of blocks of the
+// LCP array: the whole blocks of the range are covered by two overlapping
+// entries of the table, and the ends of the range, shorter than a block
+// each, are scanned. The block size trades memory for time: the table takes
+// about (n / block) log2(n / block) ints on top of the n ints of the ranks,
+// and a query scans up to 2 (block - 1) LCP values. Block 1 gives the plain
+// sparse table. The scans read a copy of the LCP array as n ints, as the
+// enhanced suffix array keeps its values of 255 or more in a list searched on
+// every access; the index does not refer to the enhanced suffix array after
+// its construction.
+class LongestCommonExtension {
+public:
+    LongestCommonExtension(const EnhancedSuffixArray& esa, int block) : block_(std::max(1, block)) {
+        int n = esa.size();
+        rank_.resize(n);
+        for (int i = 0; i < n; ++i) rank_[esa.suffix(i)] = i;
+        lcp_.resize(n);
+        for (int i = 0; i < n; ++i) lcp_[i] = esa.lcp(i);
+
+        // Level 0 holds the minimum of every block, level k the minimum of
+        // 2^k blocks from each block on
+        int blocks = (n + block_ - 1) / block_;
+        table_.emplace_back(blocks);
+        for (int b = 0; b < blocks; ++b) {
+            int minimum = lcp_[b * block_];
+            for (int i = b * block_ + 1; i < std::min(n, (b + 1) * block_); ++i) minimum = std::min(minimum, lcp_[i]);
+            table_[0][b] = minimum;
+        }
+        for (int k = 1; (1 << k) <= blocks; ++k) {
+            const std::vector<int>& previous = table_[k - 1];
+            std::vector<int> level(blocks - (1 << k) + 1);
+            for (size_t b = 0; b < level.size(); ++b) level[b] = std::min(previous[b], previous[b + (1 << (k - 1))]);
+            table_.push_back(std::move(level));
+        }
+    }
+
+    // Length of the longest common prefix of the suffixes at positions i and j.
+    // The final '$' is unique, so it is never counted, not even when i == j.
+    int lce(int i, int j) const {
+        if (i == j) return int(lcp_.size()) - i - 1;
+        int first = rank_[i], last = rank_[j];
+        if (first > last) std::swap(first, last);
+        return range_minimum(first + 1, last);
+    }
+
+    // Answer the queries (i, j) into lengths. The ranks of the queries a few
+    // ahead are prefetched, as they are random accesses into n ints.
+    void lce(const std::vector<std::pair<int, int>>& queries, std::vector<int>& lengths) const {
+        int const Lookahead = 8;
+        lengths.resize(queries.size());
+        for (size_t q = 0; q < queries.size(); ++q) {
+            if (q + Lookahead < queries.size()) {
+                __builtin_prefetch(&rank_[queries[q + Lookahead].first]);
+                __builtin_prefetch(&rank_[queries[q + Lookahead].second]);
+            }
+            lengths[q] = lce(queries[q].first, queries[q].second);
+        }
+    }
+
+    // Memory taken by the ranks, the LCP copy and the table, the enhanced suffix array apart
+    size_t bytes() const {
+        size_t total = (rank_.size() + lcp_.size()) * sizeof(int);
+        for (const auto& level : table_) total += level.size() * sizeof(int);
+        return total;
+    }
+
+private:
+    // Minimum of the LCP values of the rows [first, last], first <= last
+    int range_minimum(int first, int last) const {
+        int first_block = first / block_, last_block = last / block_;
+        int minimum = lcp_[first];
+        if (last_block - first_block < 2) {
+            for (int i = first + 1; i <= last; ++i) minimum = std::min(minimum, lcp_[i]);
+            return minimum;
+        }
+
+        // Partial blocks at both ends, then the whole blocks between them
+        for (int i = first + 1; i < (first_block + 1) * block_; ++i) minimum = std::min(minimum, lcp_[i]);
+        for (int i = last_block * block_; i <= last; ++i) minimum = std::min(minimum, lcp_[i]);
+        int left = first_block + 1, right = last_block - 1;
+        int k = 31 - __builtin_clz(right - left + 1);
+        return std::min(minimum, std::min(table_[k][left], table_[k][right - (1 << k) + 1]));
+    }
+
+    int block_;
+    std::vector<int> rank_;                  // Row of the suffix at every position
+    std::vector<int> lcp_;                   // LCP array, without the exceptions of the enhanced suffix array
+    std::vector<std::vector<int>> table_;
+};
+
+#endif
@@ -0,0 +1,120 @@
+#ifndef STRINGS_CHALLENGES_PERF_COUNTERS_H
+#define STRINGS_CHALLENGES_PERF_COUNTERS_H
+
+#include <cstdint>
+#include <cstring>
+
+#include <sys/types.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+
+// Hardware event counters of a process read through perf_event_open, plus
+// the page faults, a software event the kernel always provides. Each
+// event has its own file descriptor, so the events the CPU or the kernel
+// refuses (virtual machines rarely expose the cache events, and
+// perf_event_paranoid may forbid all of them) are simply reported as
+// unavailable. The counters follow the threads the process creates, and the
+// values are scaled when the kernel had to multiplex the events.
+class PerfCounters {
+public:
+    static int const Events = 7;
+
+    // Names of the events, also used as JSON keys
+    static const char* name(int event) {
+        static const char* const names[Events] = {
+            "cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses", "dtlb_misses", "page_faults"};
+        return names[event];
+    }
+
+    PerfCounters() {
+        for (int e = 0; e < Events; ++e) fds_[e] = -1;
+    }
+
+    ~PerfCounters() {
+        close_all();
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    // Count the user-space events of the process pid, 0 for the calling one.
+    // With on_exec the counters start when the process calls exec, otherwise
+    // right away. Return whether at least one event could be opened.
+    bool open(pid_t pid, bool on_exec) {
+        close_all();
+#ifdef __linux__
+        for (int e = 0; e < Events; ++e) {
+            struct perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            config(e, attr);
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            attr.inherit = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.disabled = on_exec;
+            attr.enable_on_exec = on_exec;
+            fds_[e] = syscall(SYS_perf_event_open, &attr, pid, -1, -1, 0);
+        }
+#else
+        (void)pid;
+        (void)on_exec;
+#endif
+        return available();
+    }
+
+    bool available() const {
+        for (int e = 0; e < Events; ++e) {
+            if (fds_[e] >= 0) return true;
+        }
+        return false;
+    }
+
+    bool available(int event) const {
+        return fds_[event] >= 0;
+    }
+
+    // Get the current value of every event, 0 for the unavailable ones
+    void read(uint64_t values[Events]) const {
+        for (int e = 0; e < Events; ++e) {
+            values[e] = 0;
+            uint64_t data[3];
+            if (fds_[e] < 0 || ::read(fds_[e], data, sizeof(data)) != sizeof(data)) continue;
+
+            // data holds the value, the time enabled and the time running
+            if (data[2] == 0) continue;
+            values[e] = data[2] < data[1] ? uint64_t(double(data[0]) * data[1] / data[2]) : data[0];
+        }
+    }
+
+private:
+#ifdef __linux__
+    static void config(int event, struct perf_event_attr& attr) {
+        uint64_t const read_miss = PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16;
+        switch (event) {
+            case 0: attr.type = PERF_TYPE_HARDWARE; attr.config = PERF_COUNT_HW_CPU_CYCLES; break;
+            case 1: attr.type = PERF_TYPE_HARDWARE; attr.config = PERF_COUNT_HW_INSTRUCTIONS; break;
+            case 2: attr.type = PERF_TYPE_HW_CACHE; attr.config = PERF_COUNT_HW_CACHE_L1D | read_miss; break;
+            case 3: attr.type = PERF_TYPE_HARDWARE; attr.config = PERF_COUNT_HW_CACHE_MISSES; break;
+            case 4: attr.type = PERF_TYPE_HARDWARE; attr.config = PERF_COUNT_HW_BRANCH_MISSES; break;
+            case 5: attr.type = PERF_TYPE_HW_CACHE; attr.config = PERF_COUNT_HW_CACHE_DTLB | read_miss; break;
+            case 6: attr.type = PERF_TYPE_SOFTWARE; attr.config = PERF_COUNT_SW_PAGE_FAULTS; break;
+        }
+    }
+#endif
+
+    void close_all() {
+        for (int e = 0; e < Events; ++e) {
+            if (fds_[e] >= 0) ::close(fds_[e]);
+            fds_[e] = -1;
+        }
+    }
+
+    int fds_[Events];
+};
+
+#endif
@@ -0,0 +1,291 @@
+#ifndef STRINGS_CHALLENGES_QUERY_SERVER_H
+#define STRINGS_CHALLENGES_QUERY_SERVER_H
+
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <errno.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "fast_input.h"
+#include "thread_pool.h"
+
+// Server answering pattern queries over a Unix domain socket, so the index is
+// built once and stays in memory across queries. A request is a line of
+// patterns separated by spaces and gets one line back, in the order of the
+// requests of the connection.
+//
+// Every connection is read by its own thread, joined once the connection is
+// closed, or before run returns. The requests of all the
+// connections are collected into batches, sent to the worker pool when a
+// worker is idle, once they hold max_patterns patterns or once their oldest
+// request has waited max_wait, so concurrent clients share the batched query
+// engine. The handler writes the
+// response of every request of a batch, and runs on several workers at once.
+class QueryServer {
+public:
+    struct Request {
+        std::string line;
+        std::vector<Span> patterns;      // Within line
+        std::string response;
+        std::chrono::steady_clock::time_point arrival;
+        std::promise<void> done;
+    };
+
+    typedef std::function<void(const std::vector<Request*>& batch)> Handler;
+
+    struct Options {
+        size_t threads = 0;              // Workers, one per core by default
+        size_t max_patterns = 256;
+        std::chrono::microseconds max_wait = std::chrono::microseconds(200);
+    };
+
+    QueryServer(const std::string& path, Handler handler, const Options& options)
+        : path_(path), handler_(std::move(handler)), options_(options),
+          stopping_(false), pending_patterns_(0), in_flight_(0), pool_(options.threads) {}
+
+    // Accept connections until SIGINT or SIGTERM, then answer the requests
+    // already received, close the connections and return
+    void run() {
+        int listener = listen_on(path_);
+        install_stop_handlers();
+        std::thread batcher([this] { batch_requests(); });
+        std::list<std::thread> readers;
+
+        // The signal may be handled by any thread, so the flag is polled
+        while (!stop_requested()) {
+            join_finished(readers);
+            pollfd waiting = {listener, POLLIN, 0};
+            if (poll(&waiting, 1, 100) <= 0) continue;
+            int connection = accept(listener, nullptr, nullptr);
+            if (connection < 0) continue;
+            {
+                std::lock_guard<std::mutex> lock(connections_mutex_);
+                connections_.insert(connection);
+            }
+            readers.emplace_back([this, connection] { serve(connection); });
+        }
+        close(listener);
+        unlink(path_.c_str());
+
+        // Stop reading the connections and wait for their last responses
+        {
+            std::lock_guard<std::mutex> lock(connections_mutex_);
+            for (int connection : connections_) shutdown(connection, SHUT_RD);
+        }
+        for (auto& reader : readers) reader.join();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        ready_.notify_all();
+        batcher.join();
+    }
+
+private:
+    static volatile std::sig_atomic_t& stop_flag() {
+        static volatile std::sig_atomic_t flag = 0;
+        return flag;
+    }
+
+    static bool stop_requested() {
+        return stop_flag() != 0;
+    }
+
+    // Stop on SIGINT and SIGTERM. A client closing its connection early must
+    // not kill the server when its response is written.
+    static void install_stop_handlers() {
+        struct sigaction action;
+        memset(&action, 0, sizeof(action));
+        action.sa_handler = [](int) { stop_flag() = 1; };
+        sigaction(SIGINT, &action, nullptr);
+        sigaction(SIGTERM, &action, nullptr);
+        signal(SIGPIPE, SIG_IGN);
+    }
+
+    static int listen_on(const std::string& path) {
+        sockaddr_un address;
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(address.sun_path)) throw std::runtime_error("socket path too long: " + path);
+        strcpy(address.sun_path, path.c_str());
+
+        int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listener < 0) throw std::runtime_error("cannot create a socket");
+        unlink(path.c_str());
+        if (bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0
+            || listen(listener, SOMAXCONN) != 0) {
+            close(listener);
+            throw std::runtime_error("cannot listen on " + path + ": " + strerror(errno));
+        }
+        return listener;
+    }
+
+    // Read the requests of a connection and write their responses. All the
+    // complete lines read at once are queued together, then answered in order.
+    void serve(int connection) {
+        std::string buffer;
+        char chunk[1 << 16];
+        std::vector<std::unique_ptr<Request>> requests;
+        for (;;) {
+            ssize_t count = read(connection, chunk, sizeof(chunk));
+            if (count < 0 && errno == EINTR) continue;
+            if (count <= 0) break;
+            buffer.append(chunk, count);
+
+            size_t start = 0, end;
+            requests.clear();
+            while ((end = buffer.find('\n', start)) != std::string::npos) {
+                requests.emplace_back(new Request());
+                parse(buffer.substr(start, end - start), *requests.back());
+                start = end + 1;
+            }
+            buffer.erase(0, start);
+            if (requests.empty()) continue;
+
+            enqueue(requests);
+            std::string responses;
+            for (auto& request : requests) {
+                request->done.get_future().wait();
+                responses += request->response;
+                responses += '\n';
+            }
+            if (!write_all(connection, responses)) break;
+        }
+        std::lock_guard<std::mutex> lock(connections_mutex_);
+        connections_.erase(connection);
+        close(connection);
+        finished_.push_back(std::this_thread::get_id());
+    }
+
+    // Join the threads of the connections closed since the last call
+    void join_finished(std::list<std::thread>& readers) {
+        std::vector<std::thread::id> finished;
+        {
+            std::lock_guard<std::mutex> lock(connections_mutex_);
+            finished.swap(finished_);
+        }
+        for (std::thread::id id : finished) {
+            for (auto reader = readers.begin(); reader != readers.end(); ++reader) {
+                if (reader->get_id() == id) {
+                    reader->join();
+                    readers.erase(reader);
+                    break;
+                }
+            }
+        }
+    }
+
+    static void parse(std::string line, Request& request) {
+        request.line = std::move(line);
+        const char* text = request.line.data();
+        size_t n = request.line.size();
+        for (size_t i = 0; i < n;) {
+            while (i < n && isspace((unsigned char)text[i])) i++;
+            size_t start = i;
+            while (i < n && !isspace((unsigned char)text[i])) i++;
+            if (i > start) request.patterns.push_back(Span(text + start, i - start));
+        }
+    }
+
+    static bool write_all(int connection, const std::string& data) {
+        size_t written = 0;
+        while (written < data.size()) {
+            ssize_t count = write(connection, data.data() + written, data.size() - written);
+            if (count < 0 && errno == EINTR) continue;
+            if (count <= 0) return false;
+            written += count;
+        }
+        return true;
+    }
+
+    void enqueue(const std::vector<std::unique_ptr<Request>>& requests) {
+        auto now = std::chrono::steady_clock::now();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (auto& request : requests) {
+                request->arrival = now;
+                pending_.push_back(request.get());
+                pending_patterns_ += request->patterns.size();
+            }
+        }
+        ready_.notify_one();
+    }
+
+    // Form the batches: wait for a first request, then, while every worker
+    // is busy, for more until the batch is full or the first one has waited
+    // max_wait. An idle worker takes the requests at once, so a lone client
+    // does not wait for a batch to fill.
+    void batch_requests() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            ready_.wait(lock, [this] { return stopping_ || !pending_.empty(); });
+            if (pending_.empty()) return;
+            auto deadline = pending_.front()->arrival + options_.max_wait;
+            ready_.wait_until(lock, deadline, [this] {
+                return stopping_ || pending_patterns_ >= options_.max_patterns || in_flight_ < pool_.size();
+            });
+
+            auto batch = std::make_shared<std::vector<Request*>>();
+            size_t patterns = 0;
+            while (!pending_.empty() && (batch->empty() || patterns + pending_.front()->patterns.size() <= options_.max_patterns)) {
+                patterns += pending_.front()->patterns.size();
+                batch->push_back(pending_.front());
+                pending_.pop_front();
+            }
+            pending_patterns_ -= patterns;
+            in_flight_++;
+
+            lock.unlock();
+            pool_.submit([this, batch] {
+                try {
+                    handler_(*batch);
+                } catch (const std::exception& error) {
+                    for (Request* request : *batch) request->response = std::string("error: ") + error.what();
+                }
+                for (Request* request : *batch) request->done.set_value();
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    in_flight_--;
+                }
+                ready_.notify_one();
+            });
+            lock.lock();
+        }
+    }
+
+    std::string path_;
+    Handler handler_;
+    Options options_;
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    std::deque<Request*> pending_;
+    bool stopping_;
+    size_t pending_patterns_;
+    size_t in_flight_;                   // Batches submitted to the workers and not answered yet
+    std::mutex connections_mutex_;
+    std::set<int> connections_;          // Open connections, closed by their threads
+    std::vector<std::thread::id> finished_; // Threads of the closed connections, not joined yet
+
+    // Last, so its workers are joined before the members their tasks use are destroyed
+    ThreadPool pool_;
+};
+
+#endif
@@ -0,0 +1,109 @@
+#ifndef STRINGS_CHALLENGES_RANK_BIT_VECTOR_H
+#define STRINGS_CHALLENGES_RANK_BIT_VECTOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Number of ones in a word. Without the popcnt instruction, the builtin is a
+// library call with a table, slower than counting in parallel in the word.
+inline int popcount64(uint64_t x) {
+#ifdef __POPCNT__
+    return __builtin_popcountll(x);
+#else
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+    return (x * 0x0101010101010101ULL) >> 56;
+#endif
+}
+
+// Bit vector of up to 2^32 bits with constant time rank. The bits are stored
+// in blocks of 32 bytes, aligned so a block never crosses a cache line: a
+// header word followed by 3 words of bits. The header holds the number of
+// ones before the block in its low 32 bits, and the number of ones in the
+// block before each of its words in the next bytes, so a rank reads one
+// header and counts the ones of one word, without branches. The headers take
+// 1/4 of the space.
+class RankBitVector {
+public:
+    RankBitVector() : size_(0), offset_(0) {}
+
+    // n bits, all zero
+    explicit RankBitVector(size_t n) : size_(n) {
+        size_t blocks = n / BlockBits + 1;
+        storage_.assign((blocks + 1) * BlockWords, 0);
+
+        // Align the blocks. A copy may lose the alignment but stays correct.
+        uintptr_t address = reinterpret_cast<uintptr_t>(storage_.data());
+        offset_ = (BlockWords - (address / sizeof(uint64_t)) % BlockWords) % BlockWords;
+    }
+
+    size_t size() const {
+        return size_;
+    }
+
+    void set(size_t i) {
+        storage_[word_index(i)] |= uint64_t(1) << (i % 64);
+    }
+
+    bool get(size_t i) const {
+        return (storage_[word_index(i)] >> (i % 64)) & 1;
+    }
+
+    // Fill the headers, once all the bits are set
+    void build_rank() {
+        uint32_t ones = 0;
+        uint64_t* blocks = storage_.data() + offset_;
+        for (size_t b = 0; b <= size_ / BlockBits; ++b) {
+            uint64_t* block = blocks + b * BlockWords;
+            uint64_t header = ones;
+            int in_block = 0;
+            for (int w = 0; w < DataWords; ++w) {
+                header |= uint64_t(in_block) << (32 + 8 * w);
+                in_block += popcount64(block[1 + w]);
+            }
+            block[0] = header;
+            ones += in_block;
+        }
+    }
+
+    // Number of ones in the bits [0, i)
+    size_t rank1(size_t i) const {
+        const uint64_t* block = storage_.data() + offset_ + i / BlockBits * BlockWords;
+        size_t bit = i % BlockBits;
+        uint64_t header = block[0];
+        uint64_t below = block[1 + bit / 64] & ((uint64_t(1) << (bit % 64)) - 1);
+        return uint32_t(header) + ((header >> (32 + 8 * (bit / 64))) & 0xff) + popcount64(below);
+    }
+
+    // Number of zeros in the bits [0, i)
+    size_t rank0(size_t i) const {
+        return i - rank1(i);
+    }
+
+    // Start loading the block that rank1(i) reads
+    void prefetch(size_t i) const {
+        __builtin_prefetch(storage_.data() + offset_ + i / BlockBits * BlockWords);
+    }
+
+    // Memory taken by the bits and the headers
+    size_t bytes() const {
+        return storage_.size() * sizeof(uint64_t);
+    }
+
+private:
+    static int const BlockWords = 4;
+    static int const DataWords = BlockWords - 1;
+    static int const BlockBits = DataWords * 64;
+
+    size_t word_index(size_t i) const {
+        return offset_ + i / BlockBits * BlockWords + 1 + i % BlockBits / 64;
+    }
+
+    size_t size_;
+    size_t offset_;                  // Words before the first block, for alignment
+    std::vector<uint64_t> storage_;
+};
+
+#endif
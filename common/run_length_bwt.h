@@ -0,0 +1,210 @@
+#ifndef STRINGS_CHALLENGES_RUN_LENGTH_BWT_H
+#define STRINGS_CHALLENGES_RUN_LENGTH_BWT_H
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Run-length encoded Burrows-Wheeler transform with the sampling of the
+// r-index, for collections of near-identical texts whose BWT has few runs.
+// Everything is stored per run, so rank, LF and backward search take
+// O(log r) per step and the index takes O(r) memory, where r is the number
+// of runs, instead of O(n) for the text length n.
+//
+// Locating the occurrences uses the toehold lemma: backward search keeps the
+// suffix array value of the last row of its interval, known from the samples
+// at the ends of the runs. The other rows of the interval are reached with
+// phi(SA[i]) = SA[i - 1], which only needs a sample at the start of each run.
+class RunLengthBWT {
+public:
+    // Rows [top, bottom] of the BWT matrix prefixed by a pattern, and the
+    // position in the text of the suffix at row bottom
+    struct Match {
+        int top;
+        int bottom;
+        int toehold;
+
+        int count() const {
+            return bottom - top + 1;
+        }
+    };
+
+    // Index the BWT of a text ending with '$'. The text is walked backwards
+    // once through LF to sample the suffix array at the run boundaries.
+    template <typename Text>
+    explicit RunLengthBWT(const Text& bwt) : n_(bwt.size()), letters_(256) {
+        // Split the BWT into runs and count the characters
+        std::vector<int> counts(256, 0);
+        for (int i = 0; i < n_; ++i) {
+            unsigned char c = bwt[i];
+            if (i == 0 || c != run_char_.back()) {
+                LetterRuns& runs = letters_[c];
+                runs.start.push_back(i);
+                runs.before.push_back(counts[c]);
+                runs.run.push_back(run_start_.size());
+                run_start_.push_back(i);
+                run_char_.push_back(c);
+            }
+            counts[c]++;
+        }
+        run_start_.push_back(n_);
+        for (auto& runs : letters_) {
+            runs.start.shrink_to_fit();
+            runs.before.shrink_to_fit();
+            runs.run.shrink_to_fit();
+        }
+
+        // First row of every character in the sorted first column
+        starts_.assign(257, 0);
+        for (int c = 0; c < 256; ++c) starts_[c + 1] = starts_[c] + counts[c];
+
+        sample_suffix_array();
+    }
+
+    int size() const {
+        return n_;
+    }
+
+    int runs() const {
+        return run_char_.size();
+    }
+
+    // Memory taken by the index
+    size_t bytes() const {
+        size_t total = run_start_.size() * sizeof(int) + run_char_.size()
+            + (sample_end_.size() + phi_.size() * 2) * sizeof(int) + starts_.size() * sizeof(int);
+        for (const auto& runs : letters_) total += runs.start.size() * 3 * sizeof(int);
+        return total;
+    }
+
+    // Rows of the whole matrix, with the toehold at the last row
+    Match all() const {
+        return Match{0, n_ - 1, sample_end_.back()};
+    }
+
+    // Extend a non-empty match to the left with character c. The result is
+    // empty, top > bottom, when c never precedes the match.
+    Match extend(const Match& match, unsigned char c) const {
+        const LetterRuns& runs = letters_[c];
+
+        // Last run of c starting at or before bottom, if any
+        int k = std::upper_bound(runs.start.begin(), runs.start.end(), match.bottom) - runs.start.begin() - 1;
+        if (k < 0) return Match{1, 0, 0};
+        int run = runs.run[k];
+        int last = std::min(match.bottom, run_start_[run + 1] - 1);
+        int bottom = starts_[c] + runs.before[k] + (last - runs.start[k]);
+        int top = starts_[c] + rank(c, match.top);
+        if (top > bottom) return Match{1, 0, 0};
+
+        // The suffix at row last is one character longer than the one at
+        // the new bottom. Either last is bottom, whose value is the toehold,
+        // or it ends a run of c and is sampled.
+        int toehold = last == match.bottom ? match.toehold : sample_end_[run];
+        return Match{top, bottom, toehold - 1};
+    }
+
+    // Match a pattern by backward search
+    template <typename Pattern>
+    Match find(const Pattern& pattern) const {
+        Match match = all();
+        for (int i = int(pattern.size()) - 1; i >= 0 && match.top <= match.bottom; --i) {
+            match = extend(match, pattern[i]);
+        }
+        return match;
+    }
+
+    // Positions in the text of the rows of a match, from the bottom row up
+    template <typename Output>
+    void locate(const Match& match, Output& positions) const {
+        if (match.top > match.bottom) return;
+        int position = match.toehold;
+        positions.push_back(position);
+        for (int i = match.bottom; i > match.top; --i) {
+            position = phi(position);
+            positions.push_back(position);
+        }
+    }
+
+    // Number of occurrences of c in the rows [0, i)
+    int rank(unsigned char c, int i) const {
+        const LetterRuns& runs = letters_[c];
+        int k = std::upper_bound(runs.start.begin(), runs.start.end(), i - 1) - runs.start.begin() - 1;
+        if (k < 0) return 0;
+        int end = run_start_[runs.run[k] + 1];
+        return runs.before[k] + std::min(i, end) - runs.start[k];
+    }
+
+    // Character of the BWT at row i
+    unsigned char access(int i) const {
+        return run_char_[run_of(i)];
+    }
+
+    // Suffix array value of the row above the one whose value is position
+    int phi(int position) const {
+        // Last sample at the start of a run with a value up to position:
+        // the rows below them shift together until the next run boundary
+        auto it = std::upper_bound(phi_.begin(), phi_.end(), std::make_pair(position, n_)) - 1;
+        return it->second + (position - it->first);
+    }
+
+private:
+    // Runs of one character, in order: their first row, the occurrences of
+    // the character before them and the index of the run among all the runs
+    struct LetterRuns {
+        std::vector<int> start;
+        std::vector<int> before;
+        std::vector<int> run;
+    };
+
+    int run_of(int i) const {
+        return std::upper_bound(run_start_.begin(), run_start_.end(), i) - run_start_.begin() - 1;
+    }
+
+    // Walk the text backwards from its end through LF, recording the suffix
+    // array at the last row of every run and, for the first row of every run
+    // but the first, the pair (SA[row], SA[row - 1]) that phi needs
+    void sample_suffix_array() {
+        int r = run_char_.size();
+        sample_end_.assign(r, 0);
+        std::vector<int> sample_start(r, 0);
+
+        // Row of the first character of every run in the first column, so
+        // LF is a single predecessor search
+        std::vector<int> first_row(r);
+        for (int c = 0; c < 256; ++c) {
+            const LetterRuns& runs = letters_[c];
+            for (size_t k = 0; k < runs.run.size(); ++k) {
+                first_row[runs.run[k]] = starts_[c] + runs.before[k];
+            }
+        }
+
+        int row = 0;  // Row of the suffix "$", the last one of the text
+        for (int position = n_ - 1; position >= 0; --position) {
+            int run = run_of(row);
+            if (row == run_start_[run]) sample_start[run] = position;
+            if (row == run_start_[run + 1] - 1) sample_end_[run] = position;
+
+            // LF: the row of the suffix one character longer
+            row = first_row[run] + (row - run_start_[run]);
+        }
+
+        phi_.clear();
+        phi_.reserve(r);
+        for (int run = 1; run < r; ++run) {
+            phi_.push_back(std::make_pair(sample_start[run], sample_end_[run - 1]));
+        }
+        std::sort(phi_.begin(), phi_.end());
+    }
+
+    int n_;
+    std::vector<int> run_start_;                 // First row of every run, plus n
+    std::vector<unsigned char> run_char_;        // Character of every run
+    std::vector<LetterRuns> letters_;            // Runs of every character
+    std::vector<int> starts_;                    // First row of every character in the first column
+    std::vector<int> sample_end_;                // Suffix array at the last row of every run
+    std::vector<std::pair<int, int>> phi_;       // (SA[row], SA[row - 1]) at the first row of every run, by SA[row]
+};
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef STRINGS_CHALLENGES_SUFFIX_SORT_H
+#define STRINGS_CHALLENGES_SUFFIX_SORT_H
+
+#include <algorithm>
+#include <vector>
+
+// Sort the cyclic shifts of text[0, n) by prefix doubling with counting
+// sorts, in O(n log n), and return their starts in order. classes is left
+// with the rank of every shift, equal for equal shifts. When the text ends
+// with a unique terminator such as '$', the shifts sort like the suffixes and
+// the result is the suffix array.
+inline std::vector<int> sort_cyclic_shifts(const char* text, int n, std::vector<int>& classes) {
+    std::vector<int> order(n), new_order(n), new_classes(n), count(std::max(n, 256));
+    classes.assign(n, 0);
+    if (n == 0) return order;
+
+    // Sort the single characters
+    for (int i = 0; i < n; ++i) count[(unsigned char)text[i]]++;
+    for (int c = 1; c < 256; ++c) count[c] += count[c - 1];
+    for (int i = n - 1; i >= 0; --i) order[--count[(unsigned char)text[i]]] = i;
+    classes[order[0]] = 0;
+    for (int i = 1; i < n; ++i) {
+        classes[order[i]] = classes[order[i - 1]] + (text[order[i]] != text[order[i - 1]]);
+    }
+
+    // Double the length of the sorted shifts until all classes are distinct
+    // or the shifts are compared whole
+    for (int l = 1; l < n && classes[order[n - 1]] < n - 1; l *= 2) {
+        std::fill(count.begin(), count.begin() + n, 0);
+        for (int i = 0; i < n; ++i) count[classes[i]]++;
+        for (int c = 1; c < n; ++c) count[c] += count[c - 1];
+        for (int i = n - 1; i >= 0; --i) {
+            int start = order[i] - l < 0 ? order[i] - l + n : order[i] - l;
+            new_order[--count[classes[start]]] = start;
+        }
+        order.swap(new_order);
+
+        new_classes[order[0]] = 0;
+        for (int i = 1; i < n; ++i) {
+            int cur = order[i], prev = order[i - 1];
+            int cur_mid = cur + l < n ? cur + l : cur + l - n;
+            int prev_mid = prev + l < n ? prev + l : prev + l - n;
+            bool differ = classes[cur] != classes[prev] || classes[cur_mid] != classes[prev_mid];
+            new_classes[cur] = new_classes[prev] + differ;
+        }
+        classes.swap(new_classes);
+    }
+    return order;
+}
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef STRINGS_CHALLENGES_THREAD_POOL_H
+#define STRINGS_CHALLENGES_THREAD_POOL_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Fixed set of worker threads running tasks in submission order. Each task
+// returns a future for its result, so callers can keep several tasks in
+// flight and collect the results in order. The destructor runs the tasks
+// still queued and joins the workers.
+class ThreadPool {
+public:
+    // One worker per core by default
+    explicit ThreadPool(size_t threads = 0) : stopping_(false) {
+        if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+        for (size_t i = 0; i < threads; ++i) {
+            workers_.emplace_back([this] { run(); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        ready_.notify_all();
+        for (auto& worker : workers_) worker.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const {
+        return workers_.size();
+    }
+
+    // Queue a callable taking no arguments and get the future of its result
+    template <typename Task>
+    std::future<typename std::result_of<Task()>::type> submit(Task task) {
+        typedef typename std::result_of<Task()>::type Result;
+        auto packaged = std::make_shared<std::packaged_task<Result()>>(std::move(task));
+        std::future<Result> result = packaged->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            tasks_.push_back([packaged] { (*packaged)(); });
+        }
+        ready_.notify_one();
+        return result;
+    }
+
+private:
+    void run() {
+        for (;;) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                ready_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+                if (tasks_.empty()) return;
+                task = std::move(tasks_.front());
+                tasks_.pop_front();
+            }
+            task();
+        }
+    }
+
+    std::vector<std::thread> workers_;
+    std::deque<std::function<void()>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    bool stopping_;
+};
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef STRINGS_CHALLENGES_TREE_TRAVERSAL_H
+#define STRINGS_CHALLENGES_TREE_TRAVERSAL_H
+
+#include <vector>
+
+// Depth-first traversal of a tree whose nodes are integer indices, with an
+// explicit stack instead of recursion, so trees as deep as the text is long
+// (suffix tries of repetitive texts) cannot overflow the call stack. The
+// tree is described by a visitor with the methods
+//
+//   bool enter(int node)       pre-order; return false to skip the children,
+//                              and then leave is not called for the node
+//   int degree(int node)       number of child slots of the node
+//   int child(int node, int i) node in the i-th slot, negative for an empty slot
+//   void leave(int node)       post-order, after all the children
+//
+// The children are visited in slot order. child is called right before its
+// subtree is visited, so it may also rewrite the slot, for instance to
+// compress a path, or handle the edge to the child.
+template <typename Visitor>
+void depth_first(int root, Visitor& visitor) {
+    struct Frame {
+        int node;
+        int next;    // Next slot to visit
+        int degree;
+    };
+
+    if (!visitor.enter(root)) return;
+    std::vector<Frame> stack(1, Frame{root, 0, visitor.degree(root)});
+
+    while (!stack.empty()) {
+        Frame& top = stack.back();
+
+        // All the children were visited, leave the node
+        if (top.next == top.degree) {
+            int node = top.node;
+            stack.pop_back();
+            visitor.leave(node);
+            continue;
+        }
+
+        // Otherwise descend into the next child, if the slot is not empty
+        int child = visitor.child(top.node, top.next++);
+        if (child >= 0 && visitor.enter(child)) {
+            stack.push_back(Frame{child, 0, visitor.degree(child)});
+        }
+    }
+}
+
+#endif
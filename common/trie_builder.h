@@ -0,0 +1,218 @@
+#ifndef STRINGS_CHALLENGES_TRIE_BUILDER_H
+#define STRINGS_CHALLENGES_TRIE_BUILDER_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "arena.h"
+#include "instrument.h"
+
+// Bulk trie construction shared by the trie engines. All the patterns are
+// loaded at once: they are radix sorted and the nodes are created in DFS
+// order, so the nodes of each subtree are contiguous. Top-level subtrees are
+// sorted and built on separate threads and then stitched after the root.
+//
+// The node layout is given by a Trie type providing
+//   - Node, default-constructed without children
+//   - Letters and letter(c), the index of character c in [0, Letters)
+//   - add_child(node, c, child), setting the edge of node for c to child
+//   - end_pattern(node), called on the last node of every pattern
+//   - shift(node, offset), adding offset to every child of node
+namespace trie_builder {
+
+// Below this many patterns the top-level subtrees are built on the calling thread
+size_t const ParallelThreshold = 1 << 14;
+
+// Radix sort bucket of the character of pattern at position depth: one per
+// letter, plus bucket 0 for the patterns that end at the current depth
+template <typename Trie>
+inline int bucket_of(const std::string& pattern, size_t depth) {
+    return depth < pattern.size() ? Trie::letter(pattern[depth]) + 1 : 0;
+}
+
+// Sort patterns[lo, hi) lexicographically with an MSD radix sort, given that
+// they all share their first depth characters. buffer is scratch space of the
+// same size as patterns.
+template <typename Trie>
+void radix_sort(std::vector<const std::string*>& patterns, std::vector<const std::string*>& buffer,
+                size_t lo, size_t hi, size_t depth) {
+    int const Buckets = Trie::Letters + 1;
+
+    // Small ranges are cheaper to finish with a comparison sort
+    if (hi - lo < 32) {
+        std::sort(patterns.begin() + lo, patterns.begin() + hi, [depth] (const std::string* a, const std::string* b) {
+            return a->compare(depth, std::string::npos, *b, depth, std::string::npos) < 0;
+        });
+        return;
+    }
+
+    // Count the patterns falling in each bucket and get the bucket starts
+    size_t start[Buckets + 1] = {0};
+    for (size_t i = lo; i < hi; ++i) {
+        start[bucket_of<Trie>(*patterns[i], depth) + 1]++;
+    }
+    for (int b = 1; b <= Buckets; ++b) {
+        start[b] += start[b - 1];
+    }
+
+    // Distribute the patterns into their buckets, keeping their relative order
+    size_t next[Buckets];
+    std::copy(start, start + Buckets, next);
+    for (size_t i = lo; i < hi; ++i) {
+        buffer[lo + next[bucket_of<Trie>(*patterns[i], depth)]++] = patterns[i];
+    }
+    std::copy(buffer.begin() + lo, buffer.begin() + hi, patterns.begin() + lo);
+
+    // Sort each bucket by the next character. Bucket 0 holds patterns
+    // that already ended, so all of them are equal.
+    for (int b = 1; b < Buckets; ++b) {
+        if (start[b + 1] - start[b] > 1) {
+            radix_sort<Trie>(patterns, buffer, lo + start[b], lo + start[b + 1], depth + 1);
+        }
+    }
+}
+
+// Add to nodes the nodes spelled by the sorted patterns[lo, hi), which all
+// share their first depth characters and hang from node root. Consecutive
+// sorted patterns share their longest common prefix, so the new nodes are
+// created in DFS order and each subtree lands in a contiguous block.
+template <typename Trie>
+void insert_sorted(std::vector<typename Trie::Node>& nodes, const std::vector<const std::string*>& patterns,
+                   size_t lo, size_t hi, size_t depth, int root) {
+    // path[d] is the node reached after depth + d characters of the previous pattern
+    std::vector<int> path(1, root);
+    const std::string* previous = nullptr;
+
+    // Iterate over the patterns in lexicographic order
+    for (size_t i = lo; i < hi; ++i) {
+        const std::string& pattern = *patterns[i];
+
+        // Get the length of the prefix shared with the previous pattern
+        size_t common = depth;
+        if (previous != nullptr) {
+            size_t limit = std::min(previous->size(), pattern.size());
+            while (common < limit && (*previous)[common] == pattern[common]) common++;
+        }
+
+        // Go back to the node of the shared prefix and add the rest of the pattern
+        path.resize(common - depth + 1);
+        for (size_t j = common; j < pattern.size(); ++j) {
+            int new_node = nodes.size(); // Add the new node at the end
+            Trie::add_child(nodes[path.back()], pattern[j], new_node); // Add edge to the new node
+            nodes.push_back(typename Trie::Node()); // Add the new node
+            path.push_back(new_node); // Update the path
+        }
+
+        // The pattern is complete, mark the node
+        Trie::end_pattern(nodes[path.back()]);
+        previous = &pattern;
+    }
+}
+
+}  // namespace trie_builder
+
+// Build the trie of the non-empty patterns. With threads 0 there is one
+// worker per core from ParallelThreshold patterns on and a single one below;
+// otherwise up to threads workers, one per top-level subtree at most. Each
+// subtree is built in its own sub-arena of the current arena, if any, so the
+// workers never share one.
+template <typename Trie>
+std::vector<typename Trie::Node> build_trie_bulk(const std::vector<std::string>& patterns, int threads = 0) {
+    using namespace trie_builder;
+    typedef typename Trie::Node Node;
+    int const Buckets = Trie::Letters + 1;
+    STRINGS_PHASE("build_trie");
+
+    // Sort pointers to the patterns to avoid moving the strings around
+    size_t n = patterns.size();
+    std::vector<const std::string*> sorted(n), buffer(n);
+    for (size_t i = 0; i < n; ++i) {
+        sorted[i] = &patterns[i];
+    }
+
+    // First radix sort pass: partition the patterns by their first character,
+    // each bucket is a top-level subtree
+    size_t start[Buckets + 1] = {0};
+    for (size_t i = 0; i < n; ++i) {
+        start[bucket_of<Trie>(*sorted[i], 0) + 1]++;
+    }
+    for (int b = 1; b <= Buckets; ++b) {
+        start[b] += start[b - 1];
+    }
+    size_t next[Buckets];
+    std::copy(start, start + Buckets, next);
+    for (size_t i = 0; i < n; ++i) {
+        buffer[next[bucket_of<Trie>(*sorted[i], 0)]++] = sorted[i];
+    }
+    sorted.swap(buffer);
+
+    // Collect the top-level subtrees, empty patterns (bucket 0) add no nodes
+    struct Subtree {
+        char letter;
+        size_t lo, hi;
+        Arena* arena;
+        std::vector<Node> nodes;
+    };
+    Arena* arena = Arena::current();
+    std::vector<Subtree> subtrees;
+    for (int b = 1; b < Buckets; ++b) {
+        if (start[b] < start[b + 1]) {
+            Arena* subtree_arena = arena != nullptr ? &arena->sub_arena() : nullptr;
+            subtrees.push_back(Subtree{(*sorted[start[b]])[0], start[b], start[b + 1], subtree_arena, std::vector<Node>()});
+        }
+    }
+
+    // Sort and build each subtree on its own node vector, whose node 0
+    // is the child of the root
+    std::atomic<size_t> next_subtree(0);
+    auto worker = [&] () {
+        for (size_t s = next_subtree++; s < subtrees.size(); s = next_subtree++) {
+            Subtree& subtree = subtrees[s];
+            ArenaScope scope(subtree.arena);
+            radix_sort<Trie>(sorted, buffer, subtree.lo, subtree.hi, 1);
+            subtree.nodes.push_back(Node());
+            insert_sorted<Trie>(subtree.nodes, sorted, subtree.lo, subtree.hi, 1, 0);
+        }
+    };
+
+    // Use one thread per subtree, up to the number of workers
+    size_t workers = threads;
+    if (threads == 0) {
+        workers = n >= ParallelThreshold ? std::max(1u, std::thread::hardware_concurrency()) : 1;
+    }
+    workers = std::max<size_t>(1, std::min(workers, subtrees.size()));
+    std::vector<std::thread> pool;
+    for (size_t w = 1; w < workers; ++w) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : pool) {
+        thread.join();
+    }
+
+    // Stitch the subtrees after the root, shifting their node indices
+    size_t total = 1;
+    for (const auto& subtree : subtrees) {
+        total += subtree.nodes.size();
+    }
+    std::vector<Node> t;
+    t.reserve(total);
+    t.push_back(Node());
+    for (auto& subtree : subtrees) {
+        int offset = t.size();
+        Trie::add_child(t[0], subtree.letter, offset);
+        for (auto& node : subtree.nodes) {
+            Trie::shift(node, offset);
+            t.push_back(std::move(node));
+        }
+    }
+    STRINGS_COUNT(trie_nodes, t.size());
+    return t;
+}
+
+#endif
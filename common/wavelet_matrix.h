@@ -0,0 +1,115 @@
+#ifndef STRINGS_CHALLENGES_WAVELET_MATRIX_H
+#define STRINGS_CHALLENGES_WAVELET_MATRIX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "rank_bit_vector.h"
+
+// Sequence of symbols in [0, sigma), sigma up to 256, answering rank and
+// access in O(log sigma) with about n log sigma bits. Level l holds bit l of
+// every symbol, the most significant first, with the symbols reordered
+// stably by their higher bits: those with a 0 at the previous level first.
+class WaveletMatrix {
+public:
+    WaveletMatrix() : n_(0), levels_(0) {}
+
+    template <typename Symbols>
+    WaveletMatrix(const Symbols& symbols, int sigma) : n_(symbols.size()), levels_(1) {
+        while ((1 << levels_) < sigma) levels_++;
+
+        std::vector<uint8_t> current(symbols.begin(), symbols.end());
+        std::vector<uint8_t> next(n_);
+        for (int l = 0; l < levels_; ++l) {
+            int shift = levels_ - 1 - l;
+            RankBitVector bits(n_);
+            int zeros = 0;
+            for (int i = 0; i < n_; ++i) {
+                if ((current[i] >> shift) & 1) {
+                    bits.set(i);
+                } else {
+                    zeros++;
+                }
+            }
+            bits.build_rank();
+
+            // Stable partition by the bit for the next level
+            int z = 0, o = zeros;
+            for (int i = 0; i < n_; ++i) {
+                if ((current[i] >> shift) & 1) {
+                    next[o++] = current[i];
+                } else {
+                    next[z++] = current[i];
+                }
+            }
+            current.swap(next);
+            levels_bits_.push_back(std::move(bits));
+            zeros_.push_back(zeros);
+        }
+
+        // After the last level equal symbols are together: the rank of a
+        // symbol counts from the start of its range
+        begin_.resize(1 << levels_);
+        for (int symbol = 0; symbol < (1 << levels_); ++symbol) begin_[symbol] = position(symbol, 0);
+    }
+
+    int size() const {
+        return n_;
+    }
+
+    // Number of occurrences of symbol in the positions [0, i)
+    int rank(int symbol, int i) const {
+        return position(symbol, i) - begin_[symbol];
+    }
+
+    // Symbol at position i
+    int access(int i) const {
+        int symbol = 0;
+        for (int l = 0; l < levels_; ++l) {
+            const RankBitVector& bits = levels_bits_[l];
+            if (bits.get(i)) {
+                symbol = symbol * 2 + 1;
+                i = zeros_[l] + bits.rank1(i);
+            } else {
+                symbol = symbol * 2;
+                i = bits.rank0(i);
+            }
+        }
+        return symbol;
+    }
+
+    // Start loading the first line that rank(symbol, i) reads
+    void prefetch(int i) const {
+        if (levels_ > 0) levels_bits_[0].prefetch(i);
+    }
+
+    // Memory taken by the levels
+    size_t bytes() const {
+        size_t total = begin_.size() * sizeof(int) + zeros_.size() * sizeof(int);
+        for (const auto& bits : levels_bits_) total += bits.bytes();
+        return total;
+    }
+
+private:
+    // Follow the position i down the levels along the bits of symbol
+    int position(int symbol, int i) const {
+        for (int l = 0; l < levels_; ++l) {
+            const RankBitVector& bits = levels_bits_[l];
+            if ((symbol >> (levels_ - 1 - l)) & 1) {
+                i = zeros_[l] + bits.rank1(i);
+            } else {
+                i = bits.rank0(i);
+            }
+        }
+        return i;
+    }
+
+    int n_;
+    int levels_;
+    std::vector<RankBitVector> levels_bits_;
+    std::vector<int> zeros_;     // Zeros at every level
+    std::vector<int> begin_;     // Start of the range of every symbol after the last level
+};
+
+#endif
@@ -0,0 +1,350 @@
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using std::map;
+using std::set;
+using std::string;
+using std::vector;
+
+// Run an engine on one of its sample_tests inputs and check the output against
+// the expected answer, accepting every answer the problem statement allows.
+// Usage: sample_checker [--args FILE] [--load QUERY_LOAD] MODE BINARY INPUT EXPECTED
+//   tokens     the same whitespace-separated tokens in the same order
+//   unordered  the same tokens in any order
+//   lines      the same lines in any order
+//   trie       the same trie, whatever the node numbering and edge order
+//   edges      the same edge labels of the suffix tree in the same order
+//   edge_set   the same edge labels of the suffix tree in any order
+//   line_tokens the same tokens on every line, empty lines included
+//   non_shared a substring of the first text, absent from the second one,
+//              as short as the expected answer
+//   roundtrip  the input compressed and then decompressed with -d by the engine
+//              gives back exactly the expected file
+//   fails      the engine exits with an error, its output containing the
+//              expected text
+//   serve      the engine started with --serve answers every line of
+//              INPUT.requests with the line of the expected answer, then
+//              stops on SIGINT, exiting with 0 and removing its socket. With
+//              --load, QUERY_LOAD also runs its clients against it.
+//
+// --args FILE gives the options of the engine, separated by whitespace, as
+// the sampleN.args file next to a sample. {tmp} in them stands for a new
+// temporary directory, and the engine then runs twice in a row, so a file it
+// writes there on the first run is read on the second one.
+
+string read_file(const string& path) {
+    std::ifstream file(path, std::ios::binary);
+    std::stringstream content;
+    content << file.rdbuf();
+    return content.str();
+}
+
+vector<string> split_tokens(const string& text) {
+    vector<string> tokens;
+    std::istringstream stream(text);
+    string token;
+    while (stream >> token) tokens.push_back(token);
+    return tokens;
+}
+
+vector<string> split_lines(const string& text) {
+    vector<string> lines;
+    std::istringstream stream(text);
+    string line;
+    while (std::getline(stream, line)) {
+        while (!line.empty() && (line.back() == '\r' || line.back() == ' ')) line.pop_back();
+        if (!line.empty()) lines.push_back(line);
+    }
+    return lines;
+}
+
+// Get the strings spelled from the root to every node of a trie printed as "from->to:letter"
+set<string> trie_strings(const string& output) {
+    map<int, vector<std::pair<char, int>>> children;
+    for (const auto& line : split_lines(output)) {
+        int from, to;
+        char letter;
+        if (sscanf(line.c_str(), "%d->%d:%c", &from, &to, &letter) == 3) {
+            children[from].push_back(std::make_pair(letter, to));
+        }
+    }
+    set<string> strings;
+    vector<std::pair<int, string>> stack(1, std::make_pair(0, string()));
+    while (!stack.empty()) {
+        std::pair<int, string> top = stack.back();
+        stack.pop_back();
+        strings.insert(top.second);
+        for (const auto& child : children[top.first]) {
+            stack.push_back(std::make_pair(child.second, top.second + child.first));
+        }
+    }
+    return strings;
+}
+
+// Get the labels of the edges printed as "start end", skipping the echo of the text
+vector<string> edge_labels(const string& output, const string& text) {
+    vector<string> labels;
+    for (const auto& line : split_lines(output)) {
+        int start, end;
+        if (line == text || sscanf(line.c_str(), "%d %d", &start, &end) != 2) continue;
+        labels.push_back(text.substr(start, end - start));
+    }
+    return labels;
+}
+
+// Whether the output of the engine is an answer accepted by the mode
+bool check(const string& mode, const string& input, const string& actual, const string& expected) {
+    if (mode == "roundtrip") {
+        return actual == expected;
+    } else if (mode == "tokens") {
+        return split_tokens(actual) == split_tokens(expected);
+    } else if (mode == "unordered" || mode == "lines") {
+        vector<string> a = mode == "lines" ? split_lines(actual) : split_tokens(actual);
+        vector<string> b = mode == "lines" ? split_lines(expected) : split_tokens(expected);
+        std::sort(a.begin(), a.end());
+        std::sort(b.begin(), b.end());
+        return a == b;
+    } else if (mode == "trie") {
+        return trie_strings(actual) == trie_strings(expected);
+    } else if (mode == "edges") {
+        string text = split_tokens(input)[0];
+        return edge_labels(actual, text) == edge_labels(expected, text);
+    } else if (mode == "edge_set") {
+        string text = split_tokens(input)[0];
+        vector<string> a = edge_labels(actual, text);
+        vector<string> b = edge_labels(expected, text);
+        std::sort(a.begin(), a.end());
+        std::sort(b.begin(), b.end());
+        return a == b;
+    } else if (mode == "non_shared") {
+        vector<string> texts = split_tokens(input);
+        vector<string> answer = split_tokens(actual);
+        vector<string> reference = split_tokens(expected);
+        return answer.size() == 1 && reference.size() == 1 && answer[0].size() == reference[0].size() &&
+             texts[0].find(answer[0]) != string::npos && texts[1].find(answer[0]) == string::npos;
+    } else if (mode == "fails") {
+        string message = split_lines(expected).empty() ? string() : split_lines(expected)[0];
+        return actual.find(message) != string::npos;
+    } else if (mode == "line_tokens" || mode == "serve") {
+        // Line by line, a line without any token included
+        std::istringstream a(actual), b(expected);
+        string line_a, line_b;
+        while (std::getline(b, line_b)) {
+            if (!std::getline(a, line_a) || split_tokens(line_a) != split_tokens(line_b)) return false;
+        }
+        return !std::getline(a, line_a);
+    }
+    fprintf(stderr, "unknown mode %s\n", mode.c_str());
+    return false;
+}
+
+string quote(const string& word) {
+    return "'" + word + "'";
+}
+
+// Temporary directory removed with its files at the end of the checker
+struct TemporaryDirectory {
+    string path;
+
+    TemporaryDirectory() {
+        char name[] = "/tmp/sample_checker.XXXXXX";
+        if (mkdtemp(name) != nullptr) path = name;
+    }
+
+    ~TemporaryDirectory() {
+        if (!path.empty() && system(("rm -rf " + quote(path)).c_str()) != 0) {
+            fprintf(stderr, "cannot remove %s\n", path.c_str());
+        }
+    }
+};
+
+// Run a shell command and collect its standard output, with its exit status
+string run(const string& command, int& status) {
+    FILE* pipe = popen(command.c_str(), "r");
+    if (pipe == nullptr) {
+        status = -1;
+        return string();
+    }
+    string output;
+    char chunk[4096];
+    size_t count;
+    while ((count = fread(chunk, 1, sizeof(chunk), pipe)) > 0) {
+        output.append(chunk, count);
+    }
+    status = pclose(pipe);
+    return output;
+}
+
+// Start the server, send it the requests one line at a time and collect the
+// response lines, then stop it. Return false when it misbehaves.
+bool serve(const string& binary, const vector<string>& args, const string& input_path,
+           const string& load, const string& directory, string& responses) {
+    string socket_path = directory + "/socket";
+    pid_t server = fork();
+    if (server < 0) return false;
+    if (server == 0) {
+        int input = open(input_path.c_str(), O_RDONLY);
+        if (input < 0 || dup2(input, 0) < 0) _exit(127);
+        vector<string> words(1, binary);
+        words.insert(words.end(), args.begin(), args.end());
+        words.push_back("--serve");
+        words.push_back(socket_path);
+        vector<char*> argv;
+        for (auto& word : words) argv.push_back(&word[0]);
+        argv.push_back(nullptr);
+        execv(binary.c_str(), argv.data());
+        _exit(127);
+    }
+
+    // Wait for the server to build its index and listen
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+    int connection = -1;
+    int status = 0;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+    while (connection < 0 && std::chrono::steady_clock::now() < deadline) {
+        if (waitpid(server, &status, WNOHANG) == server) {
+            fprintf(stderr, "server exited before listening\n");
+            return false;
+        }
+        connection = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (connect(connection, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+            close(connection);
+            connection = -1;
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+    }
+    bool ok = connection >= 0;
+    if (!ok) fprintf(stderr, "cannot connect to the server\n");
+
+    // One request at a time, each response read before the next request
+    string requests_path = input_path + ".requests";
+    for (const auto& request : ok ? split_lines(read_file(requests_path)) : vector<string>()) {
+        string line = request + "\n";
+        if (write(connection, line.data(), line.size()) != (ssize_t)line.size()) {
+            ok = false;
+            break;
+        }
+        char c;
+        while (read(connection, &c, 1) == 1 && c != '\n') responses += c;
+        responses += '\n';
+    }
+    if (connection >= 0) close(connection);
+
+    if (ok && !load.empty()) {
+        string output = run(quote(load) + " " + quote(socket_path) +
+                            " --clients 4 --requests 25 --patterns 2 < " + quote(requests_path), status);
+        if (status != 0 || output.find("\"requests\": 100,") == string::npos) {
+            fprintf(stderr, "load clients failed:\n%s\n", output.c_str());
+            ok = false;
+        }
+    }
+
+    // Stop the server, which must exit cleanly and remove its socket
+    kill(server, SIGINT);
+    deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+    while (waitpid(server, &status, WNOHANG) == 0) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            kill(server, SIGKILL);
+            waitpid(server, &status, 0);
+            fprintf(stderr, "server did not stop on SIGINT\n");
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        fprintf(stderr, "server exited with status %d\n", status);
+        ok = false;
+    }
+    if (access(socket_path.c_str(), F_OK) == 0) {
+        fprintf(stderr, "server left its socket behind\n");
+        ok = false;
+    }
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    vector<string> args;
+    string load;
+    int first = 1;
+    while (first + 1 < argc && argv[first][0] == '-') {
+        string option = argv[first];
+        if (option == "--args") {
+            args = split_tokens(read_file(argv[first + 1]));
+        } else if (option == "--load") {
+            load = argv[first + 1];
+        } else {
+            break;
+        }
+        first += 2;
+    }
+    if (argc - first != 4) {
+        fprintf(stderr, "usage: %s [--args FILE] [--load QUERY_LOAD] MODE BINARY INPUT EXPECTED\n", argv[0]);
+        return 2;
+    }
+    string mode = argv[first];
+    string binary = argv[first + 1];
+    string input_path = argv[first + 2];
+    string input = read_file(input_path);
+    string expected = read_file(argv[first + 3]);
+
+    // Replace {tmp} by a new directory, where the engine runs twice
+    TemporaryDirectory directory;
+    int runs = 1;
+    for (auto& arg : args) {
+        size_t at = arg.find("{tmp}");
+        if (at == string::npos) continue;
+        arg.replace(at, 5, directory.path);
+        runs = 2;
+    }
+
+    // Run the engine and collect its output
+    string actual;
+    if (mode == "serve") {
+        if (!serve(binary, args, input_path, load, directory.path, actual)) return 1;
+    }
+    string command = quote(binary);
+    for (const auto& arg : args) command += " " + quote(arg);
+    command += " < " + quote(input_path);
+    if (mode == "roundtrip") command += " | " + quote(binary) + " -d";
+    if (mode == "fails") command += " 2>&1";
+    for (int r = 0; r < runs && mode != "serve"; ++r) {
+        int status;
+        actual = run(command, status);
+        if (mode == "fails") {
+            if (status == 0) {
+                fprintf(stderr, "engine did not fail\n");
+                return 1;
+            }
+        } else if (status != 0) {
+            fprintf(stderr, "engine failed\n");
+            return 1;
+        }
+        if (r + 1 < runs && !check(mode, input, actual, expected)) break;
+    }
+
+    if (!check(mode, input, actual, expected)) {
+        fprintf(stderr, "output:\n%s\nexpected:\n%s\n", actual.c_str(), expected.c_str());
+        return 1;
+    }
+    return 0;
+}
@@ -5,46 +5,72 @@
 #include <cassert>
 #include <queue>
 
+#include "../../common/arena.h"
+#include "../../common/enhanced_suffix_array.h"
+#include "../../common/fast_input.h"
+#include "../../common/instrument.h"
+#include "../../common/tree_traversal.h"
+
 using namespace std;
 
 int const Letters =    6;
 int const NA      =   -1;
 
-struct Node {
-    int next[Letters]; // Array to store indices of child nodes for each letter
-    int string_start, string_length, start_suffix; // Start index and length of the substring represented by the edge
-    bool has_type, leaf, non_branching; // Flags to cache node type information
-    bool yellow;
+// Suffix trie in structure-of-arrays layout. Traversals mostly read the
+// children, so the child indices of all the nodes are packed in one dense
+// block, Letters per node, and the edge labels live in arrays of their own.
+// The node types and colors are bitsets, the types kept up to date as
+// children are added.
+struct SuffixTrie {
+    ArenaVector<int> next;           // next[node * Letters + letter], NA when there is no child
+    ArenaVector<int> string_start;   // Start index of the substring represented by the edge into the node
+    ArenaVector<int> string_length;  // Length of that substring
+    ArenaVector<int> start_suffix;   // Starting position of the suffix ending at a leaf, NA for other nodes
+    ArenaVector<bool> leaf;          // Nodes without children
+    ArenaVector<bool> non_branching; // Nodes with exactly one child
+    ArenaVector<bool> yellow;        // Nodes whose subtree has a suffix just in text2
+
+    int size() const {
+        return string_start.size();
+    }
 
-    // Constructor to initialize a Node
-    Node(int start, int len) : string_start(start), string_length(len), start_suffix(NA), has_type(false), leaf(false), non_branching(false), yellow(false) {
-        std::fill(next, next + Letters, NA);
+    // Get the child indices of a node
+    int* children(int node) {
+        return next.data() + size_t(node) * Letters;
     }
 
-    // Function to determine and cache the node type (leaf, non-branching, or branching)
-    void get_type() {
-        int count = 0;
-        for (int i = 0; i < Letters; ++i) {
-            if (next[i] != NA) count++;
-        }
-        has_type = true;
-        if (count == 0) {
-            leaf = true;
-        } else if (count == 1) {
-            non_branching = true;
-        }
+    const int* children(int node) const {
+        return next.data() + size_t(node) * Letters;
+    }
+
+    // Reserve space for the nodes to avoid reallocations
+    void reserve(size_t nodes) {
+        next.reserve(nodes * Letters);
+        string_start.reserve(nodes);
+        string_length.reserve(nodes);
+        start_suffix.reserve(nodes);
+        leaf.reserve(nodes);
+        non_branching.reserve(nodes);
+        yellow.reserve(nodes);
     }
 
-    // Function to check if the node is a leaf
-    bool is_leaf() {
-        if (!has_type) get_type();
-        return leaf;
+    // Add a node whose edge is the substring at position start and return its index
+    int add_node(int start, int length) {
+        for (int i = 0; i < Letters; ++i) next.push_back(NA);
+        string_start.push_back(start);
+        string_length.push_back(length);
+        start_suffix.push_back(NA);
+        leaf.push_back(true);
+        non_branching.push_back(false);
+        yellow.push_back(false);
+        return size() - 1;
     }
 
-    // Function to check if the node is non-branching
-    bool is_non_branching() {
-        if (!has_type) get_type();
-        return non_branching;
+    // Add an edge from node to child and update the type of node
+    void add_child(int node, int letter, int child) {
+        children(node)[letter] = child;
+        non_branching[node] = leaf[node];
+        leaf[node] = false;
     }
 };
 
@@ -61,15 +87,16 @@ int letterToIndex(char letter) {
 	}
 }
 
-vector<Node> build_trie(const string& text) {
+SuffixTrie build_trie(const string& text) {
 	// Initialize data structure
-	vector<Node> trie;
+	SuffixTrie trie;
 
-	// Add root node to the trie
-	trie.push_back(Node(NA, 0));
+    // Reserve space to avoid reallocations, a suffix trie
+    // has at most n(n+1)/2 nodes besides the root
+    trie.reserve(text.size() * (text.size() + 1) / 2 + 1);
 
-    // Reserve space to avoid reallocations
-    trie.reserve(text.size() * text.size());
+	// Add root node to the trie
+	trie.add_node(NA, 0);
 
 	// Iterate over the suffixes of the input text
 	for (int start_suffix = 0; start_suffix < text.size(); ++start_suffix) {
@@ -81,14 +108,13 @@ vector<Node> build_trie(const string& text) {
             // Convert the current character to its corresponding index
 			int index = letterToIndex(text[i]);
 
-            // Get a reference to the next node in the trie
-            int& next_node = trie[node].next[index];
+            // Get the next node in the trie
+            int next_node = trie.children(node)[index];
 
             // If there is no edge from the current node to the next character, create a new node
             if (next_node == NA) {
-                int new_node = trie.size(); // Get the index for the new node
-                next_node = new_node; // Add an edge from the current node to the new node
-                trie.push_back(Node(i, 1)); // Add the new node to the trie, setting the string_start to the current index i
+                int new_node = trie.add_node(i, 1); // Add the new node to the trie, setting the string_start to the current index i
+                trie.add_child(node, index, new_node); // Add an edge from the current node to the new node
                 node = new_node; // Move to the newly created node
             } else {
                 // If an edge exists, move to the next node
@@ -97,158 +123,275 @@ vector<Node> build_trie(const string& text) {
 
 			// Store in the last node the starting position of the suffix
 			if (i == text.size() - 1) {
-				trie[node].start_suffix = start_suffix;
+				trie.start_suffix[node] = start_suffix;
 			}
 		}
 	}
-    
+
     // Return the constructed trie
 	return trie;
 }
 
-void compress_node(vector<Node>& trie, Node& node, const int edge) {
-    // Get a reference to the child node of the current node along the given edge
-    int& index_child = node.next[edge];
-    Node& child_node = trie[index_child];
+void compress_node(SuffixTrie& trie, const int index_node, const int edge) {
+    // Get a reference to the child index of the current node along the given edge
+    int& index_child = trie.children(index_node)[edge];
 
     // If the child node is a leaf, there's nothing to compress, so return
-    if (child_node.is_leaf()) return;
+    if (trie.leaf[index_child]) return;
 
     // Iterate while the child node has only one child (is non-branching)
-    while (child_node.is_non_branching()) {
+    while (trie.non_branching[index_child]) {
         // Get the index of the grandchild node (the single child of the child node)
         int index_grandchild = -1;
+        const int* child = trie.children(index_child);
         for (int i = 0; i < Letters; ++i) {
-            if (child_node.next[i] != NA) {
-                index_grandchild = child_node.next[i];
+            if (child[i] != NA) {
+                index_grandchild = child[i];
             }
         }
 
-        // Get a reference to the grandchild node
-        Node& grandchild_node = trie[index_grandchild];
-
         // Update the string_start and string_length of the grandchild node
         // to reflect the compressed path
-        grandchild_node.string_start = child_node.string_start;
-        grandchild_node.string_length = child_node.string_length + 1;
+        trie.string_start[index_grandchild] = trie.string_start[index_child];
+        trie.string_length[index_grandchild] = trie.string_length[index_child] + 1;
 
-        // Update the index_child and child_node to point to the grandchild
+        // Update the index_child to point to the grandchild
         // effectively compressing the path
         index_child = index_grandchild;
-        child_node = grandchild_node;
     }
 }
 
-void build_tree(const int index_node, vector<Node>& trie, const string& text, const int n) {
-    // Get a reference to the current node in the trie
-    Node& node = trie[index_node];
+// Visitor that compresses the trie into the suffix tree while traversing it,
+// marking the yellow nodes on the way back up
+struct TreeBuilder {
+    SuffixTrie& trie;
+    const int n;
 
-    // If the current node is a leaf, check if the suffix is just in text2 (yellow node) and return
-    if (node.is_leaf()) {
-        if (node.string_start > n) node.yellow = true;
-        return;
+    bool enter(const int) {
+        return true;
     }
 
-    // Flag to check if any child of node is just in text2
-    bool just_in_text2 = false;
+    int degree(const int index_node) const {
+        // Leaves have no children
+        return trie.leaf[index_node] ? 0 : Letters;
+    }
 
-    // Iterate through the child nodes of the current node
-    for (int i = 0; i < Letters; ++i) {
-        // If there is a child node along the edge represented by index i
-        if (node.next[i] != NA) {
-            // Compress the path from the current node to the child node
-            compress_node(trie, node, i);
+    int child(const int index_node, const int i) {
+        // If there is a child node along the edge represented by index i,
+        // compress the path from the current node to the child node
+        if (trie.children(index_node)[i] != NA) {
+            compress_node(trie, index_node, i);
+        }
+        return trie.children(index_node)[i];
+    }
 
-            // Recursively build the tree from the child node
-            build_tree(node.next[i], trie, text, n);
+    void leave(const int index_node) {
+        // If the current node is a leaf, check if the suffix is just in text2 (yellow node)
+        if (trie.leaf[index_node]) {
+            if (trie.string_start[index_node] > n) trie.yellow[index_node] = true;
+            return;
+        }
 
-            // Get if any child of node is just in text2
-            if (trie[node.next[i]].yellow) just_in_text2 = true;
+        // Mark the node if any of its children is just in text2
+        const int* children = trie.children(index_node);
+        for (int i = 0; i < Letters; ++i) {
+            if (children[i] != NA && trie.yellow[children[i]]) {
+                trie.yellow[index_node] = true;
+                return;
+            }
         }
     }
+};
 
-    // Mark the node if it is just in text2
-    if (just_in_text2) node.yellow = true;
-}
+// Visitor to check tree construction
+struct TreeChecker {
+    const SuffixTrie& tree;
+    const string& text;
+    vector<int> path; // Nodes from the root to the current node
+
+    bool enter(const int index_node) {
+        if (tree.string_start[index_node] != NA) {
+            cout << path.back() << "->" << index_node << ": t = " << text.substr(tree.string_start[index_node], tree.string_length[index_node]);
+            if (tree.yellow[index_node]) {
+                cout << ", yellow";
+            }
+            cout << endl;
+        }
+        path.push_back(index_node);
+        return true;
+    }
 
-// Function to check tree construction
-void check_tree(const int parent, const int index_node, const vector<Node>& tree, const string& text, const int len) {
-	Node node = tree[index_node];
-	if (node.string_start != NA) {
-		cout << parent << "->" << index_node << ": t = " << text.substr(node.string_start, node.string_length);
-		if (node.yellow) {
-            cout << ", yellow";
-		}
-		cout << endl;
-	}
+    int degree(const int index_node) const {
+        return tree.leaf[index_node] ? 0 : Letters;
+    }
 
-	if (node.is_leaf()) return;
+    int child(const int index_node, const int i) const {
+        return tree.children(index_node)[i];
+    }
 
-	for (int i = 0; i < Letters; ++i) {
-        if (node.next[i] != NA) {
-            check_tree(index_node, node.next[i], tree, text, len);
-        }
+    void leave(const int) {
+        path.pop_back();
     }
-}
+};
 
-void get_shortest_non_shared(const int index_node, const vector<Node>& tree, const string& text, const int n, string& result, int len) {
-    // Get the current node in the suffix tree
-    Node node = tree[index_node];
-
-    // Red nodes: Suffixes starting at or after the '#' delimiter.
-    // These represent substrings exclusively within the second input string (text2), so we skip them.
-    if (node.string_start == n) {
-        return;
-
-    // Yellow nodes: Nodes with a path leading directly to characters from the second input string (text2).
-    // While not the solution themselves, they may lie on a path to a valid solution node.
-    } else if (node.yellow) {
-        len += node.string_length;
-    
-    // Green nodes: Nodes representing substrings found in the first input string (text1) but not exclusively in text2.
-    // The path from the root to the first character of this substring is a candidate solution.
-    } else {
-        // Update the shortest non-shared substring if a shorter one is found.
-        if (result.size() > ++len) {
-            int start = node.string_start - len + 1;
-            result = text.substr(start, len);
+// Visitor that searches the suffix tree for the shortest non shared substring
+struct ShortestNonShared {
+    const SuffixTrie& tree;
+    const string& text;
+    const int n;
+    string& result;
+    vector<int> lengths; // Length of the path from the root to each yellow node of the current path
+
+    bool enter(const int index_node) {
+        STRINGS_COUNT(trie_nodes_visited, 1);
+        int len = lengths.empty() ? 0 : lengths.back();
+
+        // Red nodes: Suffixes starting at or after the '#' delimiter.
+        // These represent substrings exclusively within the second input string (text2), so we skip them.
+        if (tree.string_start[index_node] == n) {
+            return false;
+
+        // Yellow nodes: Nodes with a path leading directly to characters from the second input string (text2).
+        // While not the solution themselves, they may lie on a path to a valid solution node.
+        } else if (tree.yellow[index_node]) {
+            lengths.push_back(len + tree.string_length[index_node]);
+            return true;
+
+        // Green nodes: Nodes representing substrings found in the first input string (text1) but not exclusively in text2.
+        // The path from the root to the first character of this substring is a candidate solution.
+        } else {
+            // Update the shortest non-shared substring if a shorter one is found.
+            if (result.size() > ++len) {
+                int start = tree.string_start[index_node] - len + 1;
+                result = text.substr(start, len);
+            }
+            // Stop further exploration from this node, as we've found a valid solution.
+            return false;
         }
-        // Stop further exploration from this node, as we've found a valid solution.
-        return;
     }
 
-    // Recursively explore the children nodes of the current node
-    for (int i = 0; i < Letters; ++i) {
-        if (node.next[i] != NA) {
-            get_shortest_non_shared(node.next[i], tree, text, n, result, len);
-        }
+    int degree(const int) const {
+        return Letters;
     }
-}
 
-string solve(string p, string q) {
+    int child(const int index_node, const int i) const {
+        return tree.children(index_node)[i];
+    }
+
+    void leave(const int) {
+        lengths.pop_back();
+    }
+};
+
+// Find the shortest non shared substring on the suffix trie, compressed into
+// the suffix tree. The trie has O(n^2) nodes, so this only suits short texts.
+string solve_trie(string p, string q) {
     // Get the complete text we will use to create the suffix tree
     int n = p.size();
 	string text = p + '#' + q + '$';
 
-	// Build the suffix tree from the input text
-	vector<Node> trie = build_trie(text);
-	build_tree(0, trie, text, n);
+	// Build the suffix tree from the input text, in an arena released at the end
+	Arena arena;
+	ArenaScope scope(arena);
+	SuffixTrie trie;
+	{
+		STRINGS_PHASE("build_trie");
+		trie = build_trie(text);
+	}
+	STRINGS_COUNT(trie_nodes, trie.size());
+	{
+		STRINGS_PHASE("build_tree");
+		TreeBuilder builder{trie, n};
+		depth_first(0, builder);
+	}
 
-    // check_tree(-1, 0, trie, text, n);
+    // TreeChecker checker{trie, text, vector<int>(1, -1)};
+    // depth_first(0, checker);
 
     // Get the shortest non shared substring
+    STRINGS_PHASE("query");
     string result = p;
-    get_shortest_non_shared(0, trie, text, n, result, 0);
+    ShortestNonShared search{trie, text, n, result, vector<int>()};
+    depth_first(0, search);
 
 	return result;
 }
 
-int main(void) {
-	string p;
-	cin >> p;
-	string q;
-	cin >> q;
-	string ans = solve (p, q);
+// Visitor that searches the LCP intervals of the enhanced suffix array, the
+// nodes of the suffix tree, for the shortest non shared substring: the label
+// of a node followed by the first character of the edge into a child whose
+// suffixes all start in text1 (a green node). Edges starting at the '#'
+// delimiter lead to the suffix of text2 with the delimiter (red nodes).
+struct IntervalSearch {
+    struct State {
+        bool yellow; // Some suffix below the node starts in text2
+    };
+
+    const EnhancedSuffixArray& esa;
+    const int n;
+    int best_length; // Length of the shortest candidate so far
+    int best_lb;     // Its interval, the smallest one among candidates as short
+
+    State leaf(const int i) const {
+        return State{esa.suffix(i) > n};
+    }
+
+    State open(const int, const int) const {
+        return State{false};
+    }
+
+    void child(State& parent, const int parent_lcp, const State& child, const EnhancedSuffixArray::Interval& interval) {
+        STRINGS_COUNT(intervals_visited, 1);
+
+        // Yellow children make the parent yellow too
+        if (child.yellow) {
+            parent.yellow = true;
+            return;
+        }
+
+        // Skip red children, otherwise keep the candidate if it is shorter
+        if (esa.suffix(interval.lb) + parent_lcp == n) return;
+        int length = parent_lcp + 1;
+        if (length < best_length || (length == best_length && interval.lb < best_lb)) {
+            best_length = length;
+            best_lb = interval.lb;
+        }
+    }
+
+    void close(State&, const EnhancedSuffixArray::Interval&) {}
+};
+
+EnhancedSuffixArray build_index(const string& text) {
+    STRINGS_PHASE("build_suffix_array");
+    return EnhancedSuffixArray(text);
+}
+
+// Find the shortest non shared substring by a bottom-up traversal of the
+// enhanced suffix array of the text, without building the suffix tree
+string solve(string p, string q) {
+    // Get the complete text we will use to create the suffix array
+    int n = p.size();
+    string text = p + '#' + q + '$';
+
+    EnhancedSuffixArray esa = build_index(text);
+    STRINGS_COUNT(index_bytes, esa.bytes());
+
+    // Get the shortest non shared substring, text1 itself when there is none shorter
+    STRINGS_PHASE("query");
+    IntervalSearch search{esa, n, n, int(text.size())};
+    esa.bottom_up(search);
+    if (search.best_length == n) return p;
+    return text.substr(esa.suffix(search.best_lb), search.best_length);
+}
+
+int main(int argc, char** argv) {
+	// With --trie, search the suffix tree built from the suffix trie
+	bool trie = argc > 1 && string(argv[1]) == "--trie";
+	InputReader input;
+	string p = input.next_sequence().str();
+	string q = input.next_sequence().str();
+	STRINGS_COUNT(characters, p.size() + q.size());
+	string ans = trie ? solve_trie (p, q) : solve (p, q);
 	cout << ans << endl;
 	return 0;
 }
@@ -4,9 +4,12 @@
 #include <vector>
 #include <cassert>
 
-using std::cin;
-using std::cout;
-using std::endl;
+#include "../../common/arena.h"
+#include "../../common/fast_input.h"
+#include "../../common/fast_output.h"
+#include "../../common/instrument.h"
+#include "../../common/tree_traversal.h"
+
 using std::map;
 using std::string;
 using std::vector;
@@ -14,40 +17,50 @@ using std::vector;
 int const Letters =    5;
 int const NA      =   -1;
 
-struct Node {
-    int next[Letters]; // Array to store indices of child nodes for each letter
-    int string_start, string_length; // Start index and length of the substring represented by the edge
-    bool has_type, leaf, non_branching; // Flags to cache node type information
+// Suffix trie in structure-of-arrays layout. Traversals mostly read the
+// children, so the child indices of all the nodes are packed in one dense
+// block, Letters per node, and the edge labels live in arrays of their own.
+// The node types are bitsets, kept up to date as children are added.
+struct SuffixTrie {
+    ArenaVector<int> next;           // next[node * Letters + letter], NA when there is no child
+    ArenaVector<int> string_start;   // Start index of the substring represented by the edge into the node
+    ArenaVector<int> string_length;  // Length of that substring
+    ArenaVector<bool> leaf;          // Nodes without children
+    ArenaVector<bool> non_branching; // Nodes with exactly one child
+
+    int size() const {
+        return string_start.size();
+    }
 
-    // Constructor to initialize a Node
-    Node(int i) : string_start(i), string_length(1), has_type(false), leaf(false), non_branching(false) {
-        std::fill(next, next + Letters, NA);
+    // Get the child indices of a node
+    int* children(int node) {
+        return next.data() + size_t(node) * Letters;
     }
 
-    // Function to determine and cache the node type (leaf, non-branching, or branching)
-    void get_type() {
-        int count = 0;
-        for (int i = 0; i < Letters; ++i) {
-            if (next[i] != NA) count++;
-        }
-        has_type = true;
-        if (count == 0) {
-            leaf = true;
-        } else if (count == 1) {
-            non_branching = true;
-        }
+    // Reserve space for the nodes to avoid reallocations
+    void reserve(size_t nodes) {
+        next.reserve(nodes * Letters);
+        string_start.reserve(nodes);
+        string_length.reserve(nodes);
+        leaf.reserve(nodes);
+        non_branching.reserve(nodes);
     }
 
-    // Function to check if the node is a leaf
-    bool is_leaf() {
-        if (!has_type) get_type();
-        return leaf;
+    // Add a node whose edge is the character at position start and return its index
+    int add_node(int start) {
+        for (int i = 0; i < Letters; ++i) next.push_back(NA);
+        string_start.push_back(start);
+        string_length.push_back(1);
+        leaf.push_back(true);
+        non_branching.push_back(false);
+        return size() - 1;
     }
 
-    // Function to check if the node is non-branching
-    bool is_non_branching() {
-        if (!has_type) get_type();
-        return non_branching;
+    // Add an edge from node to child and update the type of node
+    void add_child(int node, int letter, int child) {
+        children(node)[letter] = child;
+        non_branching[node] = leaf[node];
+        leaf[node] = false;
     }
 };
 
@@ -63,15 +76,16 @@ int letterToIndex(char letter) {
 	}
 }
 
-vector<Node> build_trie(const string& text) {
+SuffixTrie build_trie(const string& text) {
 	// Initialize data structure
-	vector<Node> trie;
+	SuffixTrie trie;
 
-	// Add root node to the trie
-	trie.push_back(Node(NA));
+    // Reserve space to avoid reallocations, a suffix trie
+    // has at most n(n+1)/2 nodes besides the root
+    trie.reserve(text.size() * (text.size() + 1) / 2 + 1);
 
-    // Reserve space to avoid reallocations
-    trie.reserve(text.size() * text.size());
+	// Add root node to the trie
+	trie.add_node(NA);
 
 	// Iterate over the suffixes of the input text
 	for (int start_suffix = 0; start_suffix < text.size(); ++start_suffix) {
@@ -83,14 +97,13 @@ vector<Node> build_trie(const string& text) {
             // Convert the current character to its corresponding index
 			int index = letterToIndex(text[i]);
 
-            // Get a reference to the next node in the trie
-            int& next_node = trie[node].next[index];
+            // Get the next node in the trie
+            int next_node = trie.children(node)[index];
 
             // If there is no edge from the current node to the next character, create a new node
             if (next_node == NA) {
-                int new_node = trie.size(); // Get the index for the new node
-                next_node = new_node; // Add an edge from the current node to the new node
-                trie.push_back(Node(i)); // Add the new node to the trie, setting the string_start to the current index i
+                int new_node = trie.add_node(i); // Add the new node to the trie, setting the string_start to the current index i
+                trie.add_child(node, index, new_node); // Add an edge from the current node to the new node
                 node = new_node; // Move to the newly created node
             } else {
                 // If an edge exists, move to the next node
@@ -98,70 +111,77 @@ vector<Node> build_trie(const string& text) {
             }
 		}
 	}
-    
+
     // Return the constructed trie
 	return trie;
 }
 
-void compress_node(vector<Node>& trie, Node& node, const int edge) {
-    // Get a reference to the child node of the current node along the given edge
-    int& index_child = node.next[edge];
-    Node& child_node = trie[index_child];
+void compress_node(SuffixTrie& trie, const int index_node, const int edge) {
+    // Get a reference to the child index of the current node along the given edge
+    int& index_child = trie.children(index_node)[edge];
 
     // If the child node is a leaf, there's nothing to compress, so return
-    if (child_node.is_leaf()) return;
+    if (trie.leaf[index_child]) return;
 
     // Iterate while the child node has only one child (is non-branching)
-    while (child_node.is_non_branching()) {
+    while (trie.non_branching[index_child]) {
         // Get the index of the grandchild node (the single child of the child node)
         int index_grandchild = -1;
+        const int* child = trie.children(index_child);
         for (int i = 0; i < Letters; ++i) {
-            if (child_node.next[i] != NA) {
-                index_grandchild = child_node.next[i];
+            if (child[i] != NA) {
+                index_grandchild = child[i];
             }
         }
 
-        // Get a reference to the grandchild node
-        Node& grandchild_node = trie[index_grandchild];
-
         // Update the string_start and string_length of the grandchild node
         // to reflect the compressed path
-        grandchild_node.string_start = child_node.string_start;
-        grandchild_node.string_length = child_node.string_length + 1;
+        trie.string_start[index_grandchild] = trie.string_start[index_child];
+        trie.string_length[index_grandchild] = trie.string_length[index_child] + 1;
 
-        // Update the index_child and child_node to point to the grandchild
+        // Update the index_child to point to the grandchild
         // effectively compressing the path
         index_child = index_grandchild;
-        child_node = grandchild_node;
     }
 }
 
-void build_tree(const int index_node, vector<Node>& trie, vector<string>& result, const string& text) {
-    // Get a reference to the current node in the trie
-    Node& node = trie[index_node];
+// Visitor that compresses the trie into the suffix tree while traversing it,
+// collecting the labels of the edges of the tree
+struct TreeBuilder {
+    SuffixTrie& trie;
+    vector<string>& result;
+    const string& text;
+
+    bool enter(const int index_node) {
+        STRINGS_COUNT(trie_nodes_visited, 1);
 
-    // If the current node is a leaf, add its substring to the result and return
-    if (node.is_leaf()) {
-        result.push_back(text.substr(node.string_start, node.string_length));
-        return;
+        // If the current node is a leaf, add its substring to the result, it has no children
+        if (trie.leaf[index_node]) {
+            result.push_back(text.substr(trie.string_start[index_node], trie.string_length[index_node]));
+            return false;
 
-    // If the current node is not non-branching and has a valid string_start, add its substring to the result
-    } else if (!node.is_non_branching() && node.string_start != NA) {
-        result.push_back(text.substr(node.string_start, node.string_length));
+        // If the current node is not non-branching and has a valid string_start, add its substring to the result
+        } else if (!trie.non_branching[index_node] && trie.string_start[index_node] != NA) {
+            result.push_back(text.substr(trie.string_start[index_node], trie.string_length[index_node]));
+        }
+        return true;
     }
 
-    // Iterate through the child nodes of the current node
-    for (int i = 0; i < Letters; ++i) {
-        // If there is a child node along the edge represented by index i
-        if (node.next[i] != NA) {
-            // Compress the path from the current node to the child node
-            compress_node(trie, node, i);
+    int degree(const int) const {
+        return Letters;
+    }
 
-            // Recursively build the tree from the child node
-            build_tree(node.next[i], trie, result, text);
+    int child(const int index_node, const int i) {
+        // If there is a child node along the edge represented by index i,
+        // compress the path from the current node to the child node
+        if (trie.children(index_node)[i] != NA) {
+            compress_node(trie, index_node, i);
         }
+        return trie.children(index_node)[i];
     }
-}
+
+    void leave(const int) {}
+};
 
 // Build a suffix tree of the string text and return a vector
 // with all of the labels of its edges (the corresponding 
@@ -170,22 +190,34 @@ vector<string> ComputeSuffixTreeEdges(const string& text) {
     // Initialize a vector to store the edge labels (substrings)
     vector<string> result;
 
-    // Build the suffix trie from the input text
-    vector<Node> trie = build_trie(text);
+    // Build the suffix trie from the input text, in an arena released at the end
+    Arena arena;
+    ArenaScope scope(arena);
+    SuffixTrie trie;
+    {
+        STRINGS_PHASE("build_trie");
+        trie = build_trie(text);
+    }
+    STRINGS_COUNT(trie_nodes, trie.size());
 
     // Build the suffix tree from the trie, populating the result vector with edge labels
-    build_tree(0, trie, result, text);
+    STRINGS_PHASE("build_tree");
+    TreeBuilder builder{trie, result, text};
+    depth_first(0, builder);
 
     // Return the vector of edge labels
     return result;
 }
 
 int main() {
-    string text;
-    cin >> text;
+    InputReader input;
+    string text = input.next_sequence().str();
+    STRINGS_COUNT(characters, text.size());
     vector<string> edges = ComputeSuffixTreeEdges(text);
+    OutputWriter output;
     for (int i = 0; i < edges.size(); ++i) {
-        cout << edges[i] << endl;
+        output.write(edges[i]);
+        output.put('\n');
     }
     return 0;
 }
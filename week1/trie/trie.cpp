@@ -1,60 +1,83 @@
+#include <algorithm>
+#include <cstdio>
 #include <string>
 #include <iostream>
 #include <vector>
 #include <map>
 
+#include "../../common/arena.h"
+#include "../../common/fast_input.h"
+#include "../../common/fast_output.h"
+#include "../../common/instrument.h"
+#include "../../common/trie_builder.h"
+
 using std::map;
 using std::vector;
 using std::string;
 
-typedef map<char, int> edges;
+// Edge maps allocate their tree nodes from the current arena, see common/arena.h
+typedef map<char, int, std::less<char>, ArenaAllocator<std::pair<const char, int>>> edges;
 typedef vector<edges> trie;
 
-trie build_trie(vector<string>& patterns) {
-    // Initialize data structure
-    trie t;
-
-    // Add empty mapping to the root node 0
-    edges edge;
-    t.push_back(edge);
-
-    // Iterate over the patterns
-    for (const auto& pattern : patterns) {
-        // Start from root
-        int node = 0;
-
-        // Iterate over the characters in pattern
-        for (const auto& c : pattern) {
-            // If node does not have an edge to char c, add a new node and include it
-            if (t[node].count(c) == 0) {
-                int new_node = t.size(); // Add the new node at the end
-                t[node][c] = new_node; // Add edge to the new node
-                t.push_back(edge); // Add the new node
-                node = new_node; // Update node
-
-            } else {
-                // Move on to the next node
-                node = t[node][c];
-            }
+// Edge maps as the nodes of the bulk builder, see common/trie_builder.h
+struct EdgeMapTrie {
+    typedef edges Node;
+    static int const Letters = 256;
+
+    static int letter(char c) {
+        return (unsigned char)c;
+    }
+
+    static void add_child(edges& node, char c, int child) {
+        node[c] = child;
+    }
+
+    // Every node is printed, whether a pattern ends there or not
+    static void end_pattern(edges&) {}
+
+    static void shift(edges& node, int offset) {
+        for (auto& edge : node) {
+            edge.second += offset;
+        }
+    }
+};
+
+int main(int argc, char** argv) {
+    // With -t THREADS, build the top-level subtrees on that many workers
+    // instead of one per core for large inputs
+    int threads = 0;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "-t" && i + 1 < argc) {
+            threads = std::max(0, std::stoi(argv[++i]));
+        } else {
+            fprintf(stderr, "usage: %s [-t THREADS] < input > output\n", argv[0]);
+            return 1;
         }
     }
-    return t;
-}
 
-int main() {
-    size_t n;
-    std::cin >> n;
+    InputReader input;
+    size_t n = input.next_int();
     vector<string> patterns;
+    patterns.reserve(n);
     for (size_t i = 0; i < n; i++) {
-        string s;
-        std::cin >> s;
-        patterns.push_back(s);
+        patterns.push_back(input.next_token().str());
+        STRINGS_COUNT(characters, patterns.back().size());
     }
 
-    trie t = build_trie(patterns);
+    // The edges live in the arena until the end of the program
+    Arena arena;
+    ArenaScope scope(arena);
+    trie t = build_trie_bulk<EdgeMapTrie>(patterns, threads);
+    OutputWriter output;
     for (size_t i = 0; i < t.size(); ++i) {
         for (const auto &j : t[i]) {
-            std::cout << i << "->" << j.second << ":" << j.first << "\n";
+            output.write_int(i);
+            output.write("->", 2);
+            output.write_int(j.second);
+            output.put(':');
+            output.put(j.first);
+            output.put('\n');
         }
     }
 
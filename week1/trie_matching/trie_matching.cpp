@@ -5,6 +5,10 @@
 #include <string>
 #include <vector>
 
+#include "../../common/fast_input.h"
+#include "../../common/fast_output.h"
+#include "../../common/instrument.h"
+
 using namespace std;
 
 int const Letters =    4;
@@ -33,6 +37,8 @@ int letterToIndex(char letter) {
 }
 
 vector<Node> build_trie(const vector<string>& patterns) {
+	STRINGS_PHASE("build_trie");
+
 	// Initialize data structure
 	vector<Node> trie;
 
@@ -64,10 +70,12 @@ vector<Node> build_trie(const vector<string>& patterns) {
 	return trie;
 }
 
-vector<int> solve(const string& text, int n, const vector<string>& patterns) {
+vector<int> solve(const Span& text, int n, const vector<string>& patterns) {
 	// Initialize data structures
 	vector<int> result;
 	vector<Node> trie = build_trie(patterns);
+	STRINGS_COUNT(trie_nodes, trie.size());
+	STRINGS_PHASE("query");
 
 	// Iterate over the text
 	for (int i = 0; i < text.size(); ++i) {
@@ -79,6 +87,7 @@ vector<int> solve(const string& text, int n, const vector<string>& patterns) {
 			char c = text[j];
 			// If there is a coincidence continue comparing
 			if (trie[node].next[letterToIndex(c)] != NA) {
+				STRINGS_COUNT(trie_nodes_visited, 1);
 				node = trie[node].next[letterToIndex(text[j])];
 
 			// If there is no coincidence, stop comparing
@@ -95,27 +104,25 @@ vector<int> solve(const string& text, int n, const vector<string>& patterns) {
 }
 
 int main(void) {
-	string t;
-	cin >> t;
+	InputReader input;
+	Span t = input.next_sequence();
+	STRINGS_COUNT(characters, t.size());
 
-	int n;
-	cin >> n;
+	int n = input.next_int();
 
 	vector<string> patterns(n);
 	for (int i = 0; i < n; i++)	{
-		cin >> patterns[i];
+		patterns[i] = input.next_token().str();
 	}
+	STRINGS_COUNT(queries, n);
 
 	vector<int> ans;
 	ans = solve(t, n, patterns);
 
+	OutputWriter output;
 	for (int i = 0; i < ans.size(); ++i) {
-		cout << ans[i];
-		if (i + 1 < ans.size()) {
-			cout << " ";
-		} else {
-			cout << endl;
-		}
+		output.write_int(ans[i]);
+		output.put(i + 1 < ans.size() ? ' ' : '\n');
 	}
 	return 0;
 }
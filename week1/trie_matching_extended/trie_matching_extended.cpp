@@ -5,6 +5,11 @@
 #include <string>
 #include <vector>
 
+#include "../../common/fast_input.h"
+#include "../../common/fast_output.h"
+#include "../../common/instrument.h"
+#include "../../common/trie_builder.h"
+
 using namespace std;
 
 int const Letters =    4;
@@ -30,97 +35,195 @@ int letterToIndex(char letter) {
 	}
 }
 
-vector<Node> build_trie(const vector<string>& patterns) {
-	// Initialize data structure
-	vector<Node> trie;
+// Nodes with one child slot per letter for the bulk builder, see common/trie_builder.h
+struct LetterTrie {
+	typedef ::Node Node;
+	static int const Letters = ::Letters;
+
+	static int letter(char c) {
+		return letterToIndex(c);
+	}
+
+	static void add_child(Node& node, char c, int child) {
+		node.next[letterToIndex(c)] = child;
+	}
+
+	static void end_pattern(Node& node) {
+		node.patternEnd = true;
+	}
+
+	static void shift(Node& node, int offset) {
+		for (int k = 0; k < Letters; ++k) {
+			if (node.next[k] != NA) node.next[k] += offset;
+		}
+	}
+};
 
-	// Add root node to the trie
-	trie.push_back(Node());
+// Aho-Corasick automaton built on top of the trie of the patterns
+struct Automaton {
+	vector<Node> trie;          // Trie whose missing edges are completed with the automaton transitions
+	vector<int> link;           // Failure link: node of the longest proper suffix present in the trie
+	vector<int> output;         // Output link: node of the longest proper suffix that ends a pattern
+	vector<int> pattern;        // Id of a pattern ending at the node, NA if there is none
+	vector<int> next_duplicate; // For each pattern id, the next id with the same string, NA if there is none
+	vector<int> length;         // Length of each pattern
+};
 
-	// Iterate over the patterns
-	for (const auto& pattern : patterns) {
-		// Start from root
+Automaton build_automaton(const vector<string>& patterns, int threads) {
+	// Initialize data structures
+	STRINGS_PHASE("build_automaton");
+	Automaton automaton;
+	automaton.trie = build_trie_bulk<LetterTrie>(patterns, threads);
+	vector<Node>& trie = automaton.trie;
+	int size = trie.size();
+	automaton.link.assign(size, 0);
+	automaton.output.assign(size, NA);
+	automaton.pattern.assign(size, NA);
+	automaton.next_duplicate.assign(patterns.size(), NA);
+	automaton.length.resize(patterns.size());
+
+	// Walk every pattern to find the node where it ends, chaining equal patterns.
+	// Iterate backwards so each chain lists the ids in increasing order.
+	for (int id = patterns.size() - 1; id >= 0; --id) {
+		automaton.length[id] = patterns[id].size();
+		if (patterns[id].empty()) continue;
 		int node = 0;
+		for (char c : patterns[id]) {
+			node = trie[node].next[letterToIndex(c)];
+		}
+		automaton.next_duplicate[id] = automaton.pattern[node];
+		automaton.pattern[node] = id;
+	}
 
-		// Iterate over the characters in pattern
-		for (int i = 0; i < pattern.size(); ++i) {
-			int index = letterToIndex(pattern[i]);
+	// Breadth-first traversal: the links of a node only depend on shallower nodes
+	vector<int> queue;
+	queue.reserve(size);
+	for (int k = 0; k < Letters; ++k) {
+		int& child = trie[0].next[k];
+		if (child == NA) {
+			// Missing edges of the root loop back to the root
+			child = 0;
+		} else {
+			queue.push_back(child);
+		}
+	}
 
-			// If node does not have an edge to char c, add a new node and include it
-			if (trie[node].next[index] == NA) {
-				int new_node = trie.size(); // Add the new node at the end
-				trie[node].next[index] = new_node; // Add edge to the new node
-				trie.push_back(Node()); // Add the new node
-				node = new_node; // Update node
+	for (size_t head = 0; head < queue.size(); ++head) {
+		int node = queue[head];
+		int link = automaton.link[node];
 
-			} else {
-				// Move on to the next node
-				node = trie[node].next[index];
-			}
+		// The output link skips the failure links that do not end a pattern
+		automaton.output[node] = automaton.pattern[link] != NA ? link : automaton.output[link];
 
-			// If the pattern is complete, mark the node
-			if (i == pattern.size() - 1) {
-				trie[node].patternEnd = true;
+		for (int k = 0; k < Letters; ++k) {
+			int& child = trie[node].next[k];
+			if (child == NA) {
+				// Missing edge: take the transition of the failure link
+				child = trie[link].next[k];
+			} else {
+				// Trie edge: the failure link of the child follows the same letter from the failure link
+				automaton.link[child] = trie[link].next[k];
+				queue.push_back(child);
 			}
 		}
 	}
-	return trie;
+	return automaton;
 }
 
-vector<int> solve(string text, int n, vector <string> patterns) {
-	// Initialize data structures
-	vector<int> result;
-	vector<Node> trie = build_trie(patterns);
+// Scan the text once and call visit(position, pattern_id) for every occurrence of
+// every pattern, where position is the start of the occurrence in the text.
+// Occurrences are reported in increasing order of their end position, so the total
+// time is O(|text| + number of occurrences) and nothing is buffered.
+template <typename Visitor>
+void match_all(const Automaton& automaton, const Span& text, Visitor&& visit) {
+	STRINGS_PHASE("query");
+
+	// Start from root
+	int node = 0;
 
 	// Iterate over the text
 	for (int i = 0; i < text.size(); ++i) {
-		// Start from root
-		int node = 0;
+		// Follow the transition of the current character
+		node = automaton.trie[node].next[letterToIndex(text[i])];
+
+		// Report every pattern ending at position i, following the output links
+		int end = automaton.pattern[node] != NA ? node : automaton.output[node];
+		for (; end != NA; end = automaton.output[end]) {
+			STRINGS_COUNT(output_links_followed, 1);
+			for (int id = automaton.pattern[end]; id != NA; id = automaton.next_duplicate[id]) {
+				visit(i - automaton.length[id] + 1, id);
+			}
+		}
+	}
+}
 
-		// Traverse the trie
-		for (int j = i; j < text.size(); ++j) {
-			char c = text[j];
-			// If there is a coincidence continue comparing
-			if (trie[node].next[letterToIndex(c)] != NA) {
-				node = trie[node].next[letterToIndex(text[j])];
+vector<int> solve(const Span& text, int n, const vector<string>& patterns, int threads) {
+	// Initialize data structures
+	vector<int> result;
+	vector<bool> matched(text.size(), false);
+	Automaton automaton = build_automaton(patterns, threads);
 
-			// If there is no coincidence, stop comparing
-			} else {
-				break;
-			}
+	// Mark the positions where any pattern starts
+	match_all(automaton, text, [&] (int position, int) {
+		matched[position] = true;
+	});
 
-			// If the last updated node is the end of a pattern, then add to the solution
-			if (trie[node].patternEnd) {
-				result.push_back(i);
-				break;
-			}
-		}
+	// Collect the marked positions in increasing order
+	for (int i = 0; i < text.size(); ++i) {
+		if (matched[i]) result.push_back(i);
 	}
 	return result;
 }
 
-int main(void) {
-	string t;
-	cin >> t;
+int main(int argc, char** argv) {
+	// With --all, print every (position, pattern id) pair instead of the matching positions.
+	// With -t THREADS, build the top-level subtrees of the trie on that many workers
+	// instead of one per core for large inputs.
+	bool all_matches = false;
+	int threads = 0;
+	for (int i = 1; i < argc; ++i) {
+		string arg = argv[i];
+		if (arg == "--all") {
+			all_matches = true;
+		} else if (arg == "-t" && i + 1 < argc) {
+			threads = max(0, stoi(argv[++i]));
+		} else {
+			fprintf(stderr, "usage: %s [--all] [-t THREADS] < input > output\n", argv[0]);
+			return 1;
+		}
+	}
+
+	InputReader input;
+	Span t = input.next_sequence();
+	STRINGS_COUNT(characters, t.size());
 
-	int n;
-	cin >> n;
+	int n = input.next_int();
 
 	vector<string> patterns (n);
 	for (int i = 0; i < n; i++)	{
-		cin >> patterns[i];
+		patterns[i] = input.next_token().str();
+	}
+	STRINGS_COUNT(queries, n);
+
+	if (all_matches) {
+		Automaton automaton = build_automaton(patterns, threads);
+		OutputWriter output;
+		match_all(automaton, t, [&] (int position, int id) {
+			output.write_int(position);
+			output.put(' ');
+			output.write_int(id);
+			output.put('\n');
+		});
+		return 0;
 	}
 
 	vector<int> ans;
-	ans = solve(t, n, patterns);
+	ans = solve(t, n, patterns, threads);
 
+	OutputWriter output;
 	for (int i = 0; i < ans.size(); i++)	{
-		cout << ans[i];
-		if (i + 1 < ans.size()) {
-			cout << " ";
-		} else {
-			cout << endl;
-		}
+		output.write_int(ans[i]);
+		output.put(i + 1 < ans.size() ? ' ' : '\n');
 	}
 	return 0;
 }
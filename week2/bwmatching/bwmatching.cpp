@@ -1,14 +1,20 @@
 #include <algorithm>
+#include <cstdint>
 #include <cstdio>
 #include <iostream>
-#include <map>
 #include <sstream>
 #include <string>
 #include <vector>
 
-using std::cin;
+#include "../../common/fast_input.h"
+#include "../../common/fast_output.h"
+#include "../../common/instrument.h"
+#include "../../common/query_server.h"
+#include "../../common/run_length_bwt.h"
+#include "../../common/suffix_sort.h"
+#include "../../common/wavelet_matrix.h"
+
 using std::istringstream;
-using std::map;
 using std::string;
 using std::vector;
 
@@ -36,75 +42,295 @@ char index_to_letter(int index) {
 	}
 }
 
+// Pattern letters, the ones with occurrence counts. The ending symbol $
+// never occurs in a pattern.
+int const PatternLetters = 4;
+
+// Queries advanced together by CountOccurrencesBatch
+int const DefaultBatchSize = 32;
+
+// Result of preprocessing the Burrows-Wheeler Transform bwt of some text:
+//   * starts - for each letter C, starts[C] is the first position
+//       of this letter in the sorted array of all characters of the text.
+//   * occ_count_before - for each position P in bwt and each letter C,
+//       occ_count_before[P * PatternLetters + C] is the number of occurrences
+//       of C in bwt before position P. The counts of a position are
+//       contiguous, so each LF step reads a single cache line.
+struct OccurrenceIndex {
+    int size;
+    int starts[PatternLetters];
+    vector<int> occ_count_before;
+
+    // Counts of all the letters before position p
+    const int* row(int p) const {
+        return occ_count_before.data() + size_t(p) * PatternLetters;
+    }
+
+    // Pattern characters are coded as symbols [0, letters())
+    int letters() const {
+        return PatternLetters;
+    }
+
+    // Symbol of a pattern character, -1 when it does not occur in patterns
+    int symbol(char c) const {
+        int letter = letter_to_index(c);
+        return letter < PatternLetters ? letter : -1;
+    }
+
+    // First row prefixed by the symbol and the prefix of row p
+    int lf(int symbol, int p) const {
+        return starts[symbol] + row(p)[symbol];
+    }
+
+    void prefetch(int p) const {
+        __builtin_prefetch(row(p));
+    }
+};
+
 // Preprocess the Burrows-Wheeler Transform bwt of some text
-// and compute as a result:
-//   * starts - for each character C in bwt, starts[C] is the first position 
-//       of this character in the sorted array of 
-//       all characters of the text.
-//   * occ_count_before - for each character C in bwt and each position P in bwt,
-//       occ_count_before[C][P] is the number of occurrences of character C in bwt
-//       from position 0 to position P inclusive.
-void PreprocessBWT(const string& bwt, 
-                   map<char, int>& starts, 
-                   map<char, vector<int>>& occ_count_before) {
-    
+// and compute the starts and occurrence counts of the index
+void PreprocessBWT(const Span& bwt, OccurrenceIndex& index) {
+    STRINGS_PHASE("preprocess");
+
     // Get the size
     int n = bwt.size();
+    index.size = n;
+
+    // Count the occurrences of each letter before every position
+    index.occ_count_before.assign(size_t(n + 1) * PatternLetters, 0);
+    int counts[Letters] = {0};
+    int* row = index.occ_count_before.data();
+    for (int i = 0; i < n; ++i) {
+        // Update count if the character i of bwt
+        int letter = letter_to_index(bwt[i]);
+        if (letter >= 0) counts[letter]++;
 
-    // Initialize occ_count_before vectors
-    for (int i = 0; i < Letters; ++i) {
-        occ_count_before[index_to_letter(i)] = vector<int>(n + 1, 0);
+        // Copy the counts of the next position
+        row += PatternLetters;
+        for (int j = 0; j < PatternLetters; ++j) row[j] = counts[j];
     }
 
-    // Iterate over the characters of bwt
-    for (int i = 0; i < n; ++i) {
-        // Iterate over the possible characters
-        for (int j = 0; j < Letters; ++j) {
-            // Copy previous results
-            char curr_char = index_to_letter(j);
-            occ_count_before[curr_char][i + 1] = occ_count_before[curr_char][i];
+    // Get the first position of each letter in the first column, where
+    // the sorted characters are $ and then the letters in order
+    int start = counts[letter_to_index('$')];
+    for (int j = 0; j < PatternLetters; ++j) {
+        index.starts[j] = start;
+        start += counts[j];
+    }
+}
+
+// Result of preprocessing the BWT of a text over any alphabet of bytes, such
+// as protein or natural language: the BWT as a wavelet matrix of symbols, so
+// LF takes O(log sigma) and the index about n log sigma bits instead of
+// 4 bytes per position and letter. The symbols code the characters of the
+// text but $ in byte order, and $ last.
+struct WaveletIndex {
+    int size;
+    int code[256];
+    int letter_count;
+    vector<int> starts;
+    WaveletMatrix bwt;
+
+    int letters() const {
+        return letter_count;
+    }
+
+    int symbol(char c) const {
+        int s = code[(unsigned char)c];
+        return s < letter_count ? s : -1;
+    }
+
+    int lf(int symbol, int p) const {
+        return starts[symbol] + bwt.rank(symbol, p);
+    }
+
+    void prefetch(int p) const {
+        bwt.prefetch(p);
+    }
+};
+
+// Preprocess the BWT of a text over any alphabet into a wavelet index
+void PreprocessWaveletBWT(const Span& bwt, WaveletIndex& index) {
+    STRINGS_PHASE("preprocess");
+    int n = bwt.size();
+    index.size = n;
+
+    // Code the characters that occur, $ last
+    int counts[256] = {0};
+    for (int i = 0; i < n; ++i) counts[(unsigned char)bwt[i]]++;
+    int sigma = 0;
+    for (int c = 0; c < 256; ++c) {
+        index.code[c] = -1;
+        if (counts[c] > 0 && c != '$') index.code[c] = sigma++;
+    }
+    index.letter_count = sigma;
+    if (counts['$'] > 0) index.code['$'] = sigma++;
+
+    // First row of every symbol, from the characters in byte order
+    index.starts.assign(sigma, 0);
+    int start = 0;
+    for (int c = 0; c < 256; ++c) {
+        if (counts[c] == 0) continue;
+        index.starts[index.code[c]] = start;
+        start += counts[c];
+    }
+
+    vector<uint8_t> symbols(n);
+    for (int i = 0; i < n; ++i) symbols[i] = index.code[(unsigned char)bwt[i]];
+    index.bwt = WaveletMatrix(symbols, sigma);
+}
+
+// Largest k of a k-mer table, 4^12 intervals take 128 MB
+int const MaxKmerLength = 12;
+
+// Rows [top, bottom] of the BWT matrix, empty when top > bottom
+struct RowInterval {
+    int top;
+    int bottom;
+};
+
+// Rows of the BWT matrix prefixed by every k-mer, indexed by the code of the
+// k-mer: its letters as base 4 digits, the first one most significant.
+// Backward search starts from the interval of the last k letters of a
+// pattern instead of taking its first k LF steps.
+struct KmerTable {
+    int k = 0;
+    vector<RowInterval> intervals;
+};
+
+// Compute the intervals of all the k-mers. The intervals of the strings of
+// length d come from those of length d - 1, prefixed with every letter. The
+// shorter strings are visited in order, so their intervals and the rows
+// each LF step reads are increasing, and the table is built with mostly
+// sequential memory accesses.
+void BuildKmerTable(const OccurrenceIndex& index, int k, KmerTable& table) {
+    table.k = k;
+    table.intervals.assign(1, RowInterval{0, index.size - 1});
+    vector<RowInterval> shorter;
+    for (int d = 1; d <= k; ++d) {
+        shorter.swap(table.intervals);
+        table.intervals.resize(shorter.size() * PatternLetters);
+        for (int c = 0; c < PatternLetters; ++c) {
+            RowInterval* prefixed = table.intervals.data() + c * shorter.size();
+            for (size_t x = 0; x < shorter.size(); ++x) {
+                // An empty interval stays empty, its bottom + 1 is its top
+                prefixed[x].top = index.starts[c] + index.row(shorter[x].top)[c];
+                prefixed[x].bottom = index.starts[c] + index.row(shorter[x].bottom + 1)[c] - 1;
+            }
         }
+        STRINGS_COUNT(lf_steps, table.intervals.size());
+    }
+}
 
-        // Update count if the character i of bwt
-        occ_count_before[bwt[i]][i + 1]++;
+// FNV-1a hash of the BWT, to tell whether a saved table belongs to it
+uint64_t HashBWT(const Span& bwt) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < bwt.size(); ++i) {
+        hash = (hash ^ (unsigned char)bwt[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Header of a saved k-mer table, followed by its intervals
+struct KmerTableHeader {
+    char magic[4];
+    int32_t k;
+    int32_t size;
+    uint64_t hash;
+};
+
+// Load the k-mer table saved in path for this BWT and k. Return false when
+// the file is missing or was saved for another BWT or another k.
+bool LoadKmerTable(const string& path, const Span& bwt, int k, KmerTable& table) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == nullptr) return false;
+    KmerTableHeader header;
+    bool loaded = fread(&header, sizeof(header), 1, file) == 1
+        && std::equal(header.magic, header.magic + 4, "KMER")
+        && header.k == k && header.size == int(bwt.size()) && header.hash == HashBWT(bwt);
+    if (loaded) {
+        table.k = k;
+        table.intervals.resize(size_t(1) << (2 * k));
+        loaded = fread(table.intervals.data(), sizeof(RowInterval), table.intervals.size(), file)
+            == table.intervals.size();
     }
+    fclose(file);
+    if (!loaded) table = KmerTable();
+    return loaded;
+}
 
-    // Get the first column of the suffixes
-    string first_column = bwt;
-    std::sort(first_column.begin(), first_column.end());
+void SaveKmerTable(const string& path, const Span& bwt, const KmerTable& table) {
+    FILE* file = fopen(path.c_str(), "wb");
+    KmerTableHeader header = {{'K', 'M', 'E', 'R'}, table.k, int32_t(bwt.size()), HashBWT(bwt)};
+    bool saved = file != nullptr
+        && fwrite(&header, sizeof(header), 1, file) == 1
+        && fwrite(table.intervals.data(), sizeof(RowInterval), table.intervals.size(), file)
+            == table.intervals.size();
+    if (file != nullptr && fclose(file) != 0) saved = false;
+    if (!saved) fprintf(stderr, "Could not save the k-mer table to %s\n", path.c_str());
+}
 
-    // Populate starts
-    for (int i = 0; i < n; ++i) {
-        starts.insert(std::make_pair(first_column[i], i));
+// Get the k-mer table of the BWT, from path when it was saved there before,
+// otherwise built and then saved to path, if any
+KmerTable PrepareKmerTable(const Span& bwt, const OccurrenceIndex& index, int k, const string& path) {
+    STRINGS_PHASE("kmer_table");
+    KmerTable table;
+    if (!path.empty() && LoadKmerTable(path, bwt, k, table)) return table;
+    BuildKmerTable(index, k, table);
+    if (!path.empty()) SaveKmerTable(path, bwt, table);
+    return table;
+}
+
+// Start the backward search of a pattern with the interval of its last k
+// letters, or of the empty string when it is shorter than k or there is no
+// table. Return the position of the next letter to match. The interval is
+// empty when one of the k letters is not a pattern letter.
+template <typename Index>
+int StartBackwardSearch(const Span& pattern, const Index& index, const KmerTable& kmers, RowInterval& rows) {
+    int m = pattern.size();
+    if (kmers.k == 0 || m < kmers.k) {
+        rows = RowInterval{0, index.size - 1};
+        return m - 1;
+    }
+    size_t code = 0;
+    for (int i = m - kmers.k; i < m; ++i) {
+        int symbol = index.symbol(pattern[i]);
+        if (symbol < 0) {
+            rows = RowInterval{1, 0};
+            return -1;
+        }
+        code = code * PatternLetters + symbol;
     }
+    rows = kmers.intervals[code];
+    return m - kmers.k - 1;
 }
 
 // Compute the number of occurrences of string pattern in the text
 // given only Burrows-Wheeler Transform bwt of the text and additional
 // information we get from the preprocessing stage - starts and occ_counts_before.
-int CountOccurrences(const string& pattern, 
-                     const string& bwt, 
-                     const map<char, int>& starts, 
-                     const map<char, vector<int>>& occ_count_before) {
-    
-    // Define pointers
-    int top = 0;
-    int bottom = bwt.size() - 1;
-    int i = pattern.size() - 1;
+// Index is either the OccurrenceIndex of DNA or the WaveletIndex of any text.
+template <typename Index>
+int CountOccurrences(const Span& pattern, const Index& index, const KmerTable& kmers) {
+    // Define pointers, past the last k letters with a k-mer table
+    RowInterval rows;
+    int i = StartBackwardSearch(pattern, index, kmers, rows);
+    int top = rows.top;
+    int bottom = rows.bottom;
 
     // Iterate while we have possible matchings
     while (top <= bottom) {
         // Go through the pattern in backwards order
         if (i >= 0) {
             // Get the current symbol
-            char symbol = pattern[i--];
+            int symbol = index.symbol(pattern[i--]);
 
             // If symbol is not in bwt then there is no a possible match
-            if (starts.count(symbol) == 0) return 0;
+            if (symbol < 0) return 0;
+            STRINGS_COUNT(lf_steps, 1);
 
             // Update pointers
-            top = starts.at(symbol) + occ_count_before.at(symbol)[top];
-            bottom = starts.at(symbol) + occ_count_before.at(symbol)[bottom + 1] - 1;
+            top = index.lf(symbol, top);
+            bottom = index.lf(symbol, bottom + 1) - 1;
 
         // There are no more characters to check, return solution
         } else {
@@ -116,31 +342,632 @@ int CountOccurrences(const string& pattern,
     return 0;
 }
 
-int main() {
-    string bwt;
-    cin >> bwt;
-    int pattern_count;
-    cin >> pattern_count;
+// Compute the number of occurrences of every pattern like CountOccurrences,
+// advancing a batch of patterns one symbol at a time in lockstep. After each
+// step of a pattern, the rows of its next step are prefetched, and they are
+// only read once the other patterns of the batch have taken their step, so
+// the cache misses of the whole batch overlap instead of following each other.
+template <typename Index>
+void CountOccurrencesBatch(const vector<Span>& patterns,
+                           const Index& index,
+                           const KmerTable& kmers,
+                           vector<int>& counts) {
+    struct Query {
+        int i, top, bottom;
+    };
+    int batch = patterns.size();
+    vector<Query> queries(batch);
+    vector<int> active;
+    counts.assign(batch, 0);
+
+    // Start every pattern, prefetching the rows of its first step
+    for (int q = 0; q < batch; ++q) {
+        RowInterval rows;
+        int i = StartBackwardSearch(patterns[q], index, kmers, rows);
+        queries[q] = Query{i, rows.top, rows.bottom};
+        if (rows.top > rows.bottom) continue;
+        index.prefetch(rows.top);
+        index.prefetch(rows.bottom + 1);
+        active.push_back(q);
+    }
+
+    // Each round advances every active pattern by one symbol
+    while (!active.empty()) {
+        int remaining = 0;
+        for (int q : active) {
+            Query& query = queries[q];
+
+            // The whole pattern is matched
+            if (query.i < 0) {
+                counts[q] = query.bottom - query.top + 1;
+                continue;
+            }
+
+            // If symbol is not in bwt then there is no a possible match
+            int symbol = index.symbol(patterns[q][query.i--]);
+            if (symbol < 0) continue;
+            STRINGS_COUNT(lf_steps, 1);
+
+            // Update pointers
+            query.top = index.lf(symbol, query.top);
+            query.bottom = index.lf(symbol, query.bottom + 1) - 1;
+            if (query.top > query.bottom) continue;
+
+            // Fetch the rows of the next step while the other patterns advance
+            index.prefetch(query.top);
+            index.prefetch(query.bottom + 1);
+            active[remaining++] = q;
+        }
+        active.resize(remaining);
+    }
+}
+
+// Compute a lower bound on the number of mismatches needed to match each prefix
+// of the pattern: lower_bound[i] bounds the mismatches in pattern[0..i].
+// The pattern is split from right to left into pieces, each one extended
+// backwards until it no longer occurs in the text. The pieces are disjoint
+// and each of them needs at least one mismatch, so a prefix needs at least
+// as many mismatches as the number of pieces it contains.
+template <typename Index>
+vector<int> ComputeMismatchLowerBound(const Span& pattern, const Index& index) {
+    // Initialize data structure
+    int m = pattern.size();
+    vector<int> lower_bound(m, 0);
+
+    // Define pointers of the current piece, which ends at position end
+    int top = 0;
+    int bottom = index.size - 1;
+    int end = m - 1;
+
+    // pieces_ending[j] counts the pieces whose right end is position j
+    vector<int> pieces_ending(m, 0);
+
+    // Go through the pattern in backwards order
+    for (int i = m - 1; i >= 0; --i) {
+        int symbol = index.symbol(pattern[i]);
+
+        // Extend the current piece with the symbol
+        STRINGS_COUNT(lf_steps, 1);
+        if (symbol >= 0) {
+            top = index.lf(symbol, top);
+            bottom = index.lf(symbol, bottom + 1) - 1;
+        } else {
+            top = bottom + 1;
+        }
+
+        // The piece pattern[i..end] does not occur in the text,
+        // close it and start a new piece to its left
+        if (top > bottom) {
+            pieces_ending[end]++;
+            top = 0;
+            bottom = index.size - 1;
+            end = i - 1;
+        }
+    }
+
+    // pattern[0..i] contains the pieces whose right end is at or before i
+    int pieces = 0;
+    for (int i = 0; i < m; ++i) {
+        pieces += pieces_ending[i];
+        lower_bound[i] = pieces;
+    }
+    return lower_bound;
+}
+
+// Compute the number of occurrences of string pattern in the text with
+// at most max_mismatches mismatches, using the same preprocessed index
+// as CountOccurrences. Backward search branches into every
+// letter that keeps the interval non-empty, spending one mismatch when it
+// differs from the pattern. Branches are explored with an explicit stack,
+// bounded by the pattern length, and pruned as soon as the remaining
+// mismatches fall below the lower bound of the unprocessed prefix.
+template <typename Index>
+int CountApproximateOccurrences(const Span& pattern, int max_mismatches, const Index& index) {
+    // Get the lower bound of mismatches for every prefix
+    int m = pattern.size();
+    vector<int> lower_bound = ComputeMismatchLowerBound(pattern, index);
+
+    // Each branch stores the next pattern position to match,
+    // its interval and the mismatches it can still spend
+    struct Branch {
+        int i, top, bottom, mismatches_left;
+    };
+    vector<Branch> stack(1, Branch{m - 1, 0, index.size - 1, max_mismatches});
+    int count = 0;
+
+    while (!stack.empty()) {
+        Branch branch = stack.back();
+        stack.pop_back();
+        STRINGS_COUNT(branches, 1);
+
+        // The whole pattern is matched, every row of the interval is an occurrence
+        if (branch.i < 0) {
+            count += branch.bottom - branch.top + 1;
+            continue;
+        }
+
+        // The prefix left to match needs more mismatches than available
+        if (branch.mismatches_left < lower_bound[branch.i]) continue;
+
+        // Try to extend the match with every letter
+        int symbol = index.symbol(pattern[branch.i]);
+        for (int j = 0; j < index.letters(); ++j) {
+            int mismatches_left = branch.mismatches_left - (j != symbol);
+            if (mismatches_left < 0) continue;
+
+            // Update pointers
+            STRINGS_COUNT(lf_steps, 1);
+            int top = index.lf(j, branch.top);
+            int bottom = index.lf(j, branch.bottom + 1) - 1;
+            if (top <= bottom) {
+                stack.push_back(Branch{branch.i - 1, top, bottom, mismatches_left});
+            }
+        }
+    }
+    return count;
+}
+
+// Rows of a string W in the BWT of the text and of its reverse in the BWT of
+// the reversed text. Both ranges have the same size.
+struct BiInterval {
+    int forward;
+    int reverse;
+    int size;
+};
+
+// Bidirectional FM-index: the occurrence tables of the BWT of the text and of
+// the BWT of the reversed text, with synchronised intervals, so a match can
+// be extended with a letter on either side in O(1).
+struct BidirectionalIndex {
+    OccurrenceIndex forward;
+    OccurrenceIndex reverse;
+
+    BiInterval all() const {
+        return BiInterval{0, 0, forward.size};
+    }
+
+    // Interval of cW from the one of W
+    BiInterval extend_left(const BiInterval& match, int symbol) const {
+        BiInterval extended;
+        extend(forward, match.forward, match.reverse, match.size, symbol,
+               extended.forward, extended.reverse, extended.size);
+        return extended;
+    }
+
+    // Interval of Wc from the one of W
+    BiInterval extend_right(const BiInterval& match, int symbol) const {
+        BiInterval extended;
+        extend(reverse, match.reverse, match.forward, match.size, symbol,
+               extended.reverse, extended.forward, extended.size);
+        return extended;
+    }
+
+private:
+    // Extend the rows [top, top + size) of index with symbol. In the other
+    // BWT, the rows of the match are ordered by the character after it on
+    // the side of the extension, so those of symbol come after the ones of $
+    // and of the smaller letters.
+    static void extend(const OccurrenceIndex& index, int top, int other, int size, int symbol,
+                       int& new_top, int& new_other, int& new_size) {
+        const int* before = index.row(top);
+        const int* after = index.row(top + size);
+        int smaller = size;
+        for (int j = 0; j < PatternLetters; ++j) smaller -= after[j] - before[j];
+        for (int j = 0; j < symbol; ++j) smaller += after[j] - before[j];
+        new_top = index.starts[symbol] + before[symbol];
+        new_other = other + smaller;
+        new_size = after[symbol] - before[symbol];
+    }
+};
+
+// Build the bidirectional index from the BWT of a DNA text. The text is
+// recovered by LF from its BWT, then reversed and sorted again.
+void PreprocessBidirectional(const Span& bwt, BidirectionalIndex& index) {
+    PreprocessBWT(bwt, index.forward);
+    STRINGS_PHASE("reverse");
+    int n = bwt.size();
+
+    // Walk the text backwards from the row of "$", the last suffix
+    string reversed(n, '$');
+    int row = 0;
+    for (int i = 0; i < n - 1; ++i) {
+        int letter = letter_to_index(bwt[row]);
+        reversed[i] = bwt[row];
+        row = index.forward.lf(letter, row);
+    }
+
+    // The suffix array of the reversed text gives its BWT
+    vector<int> classes;
+    vector<int> order = sort_cyclic_shifts(reversed.data(), n, classes);
+    string reversed_bwt(n, '$');
+    for (int i = 0; i < n; ++i) {
+        reversed_bwt[i] = reversed[order[i] == 0 ? n - 1 : order[i] - 1];
+    }
+    PreprocessBWT(reversed_bwt, index.reverse);
+}
+
+// A super-maximal exact match of a read: read[begin, end) occurs in the
+// text, cannot be extended on either side, and is not contained in another
+// such match
+struct SMEM {
+    int begin;
+    int end;
+    BiInterval rows;
+};
+
+// Find the SMEMs of the read that contain position x and append those of at
+// least min_length letters, as BWA does: extend forwards from x while the
+// match occurs, keeping the matches where the number of occurrences drops,
+// then extend all of them backwards in lockstep. A match that cannot be
+// extended backwards is an SMEM when no longer one reaches further left.
+// Return the end of the longest match from x, where the next search starts.
+int FindSMEMsAt(const Span& read, int x, int min_length, const BidirectionalIndex& index, vector<SMEM>& smems) {
+    int m = read.size();
+    vector<SMEM> current, previous;
+
+    // Forward extension from x, longest matches last
+    SMEM match = {x, x + 1, index.extend_left(index.all(), index.forward.symbol(read[x]))};
+    if (match.rows.size == 0) return x + 1;
+    int end = x + 1;
+    for (; end < m; ++end) {
+        int symbol = index.forward.symbol(read[end]);
+        if (symbol < 0) break;
+        STRINGS_COUNT(lf_steps, 1);
+        BiInterval extended = index.extend_right(match.rows, symbol);
+        if (extended.size != match.rows.size) current.push_back(match);
+        if (extended.size == 0) break;
+        match = SMEM{x, end + 1, extended};
+    }
+    if (end == m || index.forward.symbol(read[end]) < 0) current.push_back(match);
+    std::reverse(current.begin(), current.end());
+    int next = current[0].end;
+
+    // Backward extension of all the matches, longest first
+    size_t first_new = smems.size();
+    for (int i = x - 1; i >= -1; --i) {
+        previous.swap(current);
+        current.clear();
+        int symbol = i < 0 ? -1 : index.forward.symbol(read[i]);
+        for (const SMEM& candidate : previous) {
+            BiInterval extended = {0, 0, 0};
+            if (symbol >= 0) {
+                STRINGS_COUNT(lf_steps, 1);
+                extended = index.extend_left(candidate.rows, symbol);
+            }
+            if (extended.size == 0) {
+                // A longer match extends further left, this one is contained in it
+                if (!current.empty()) continue;
+
+                // Skip the matches contained in the last SMEM found
+                if (smems.size() > first_new && smems.back().begin <= i + 1) continue;
+                SMEM smem = candidate;
+                smem.begin = i + 1;
+                smems.push_back(smem);
+            } else if (current.empty() || extended.size != current.back().rows.size) {
+                current.push_back(SMEM{i, candidate.end, extended});
+            }
+        }
+        if (current.empty()) break;
+    }
+
+    // Drop the short ones and order by begin
+    size_t kept = first_new;
+    for (size_t j = first_new; j < smems.size(); ++j) {
+        if (smems[j].end - smems[j].begin >= min_length) smems[kept++] = smems[j];
+    }
+    smems.resize(kept);
+    std::reverse(smems.begin() + first_new, smems.end());
+    return next;
+}
+
+// Find all the SMEMs of at least min_length letters of the read, by begin
+void FindSMEMs(const Span& read, int min_length, const BidirectionalIndex& index, vector<SMEM>& smems) {
+    smems.clear();
+    int x = 0;
+    while (x < int(read.size())) {
+        if (index.forward.symbol(read[x]) < 0) {
+            x++;
+            continue;
+        }
+        x = FindSMEMsAt(read, x, min_length, index, smems);
+    }
+}
+
+// Write the SMEMs of every read as triples of begin, end and number of
+// occurrences, one line per read
+void MatchSMEMs(InputReader& input, const Span& bwt, int pattern_count, int min_length) {
+    BidirectionalIndex index;
+    PreprocessBidirectional(bwt, index);
+    STRINGS_COUNT(index_bytes, 2 * index.forward.occ_count_before.size() * sizeof(int));
+
+    OutputWriter output;
+    STRINGS_PHASE("query");
+    vector<SMEM> smems;
+    for (int pi = 0; pi < pattern_count; ++pi) {
+        Span read = input.next_token();
+        FindSMEMs(read, min_length, index, smems);
+        STRINGS_COUNT(smems, smems.size());
+        for (size_t j = 0; j < smems.size(); ++j) {
+            if (j > 0) output.put(' ');
+            output.write_int(smems[j].begin);
+            output.put(' ');
+            output.write_int(smems[j].end);
+            output.put(' ');
+            output.write_int(smems[j].rows.size);
+        }
+        output.put('\n');
+    }
+}
+
+RunLengthBWT BuildRunLengthBWT(const Span& bwt) {
+    STRINGS_PHASE("preprocess");
+    return RunLengthBWT(bwt);
+}
+
+// Count the occurrences of every pattern with the run-length encoded BWT,
+// or with locate write their positions in the text, one line per pattern
+void MatchRunLengthBWT(InputReader& input, const Span& bwt, int pattern_count, bool locate) {
+    RunLengthBWT index = BuildRunLengthBWT(bwt);
+    STRINGS_COUNT(runs, index.runs());
+    STRINGS_COUNT(index_bytes, index.bytes());
+
+    OutputWriter output;
+    STRINGS_PHASE("query");
+    vector<int> positions;
+    for (int pi = 0; pi < pattern_count; ++pi) {
+        Span pattern = input.next_token();
+        STRINGS_COUNT(lf_steps, pattern.size());
+        RunLengthBWT::Match match = index.find(pattern);
+        if (!locate) {
+            output.write_int(std::max(match.count(), 0));
+            output.put(' ');
+            continue;
+        }
+        positions.clear();
+        index.locate(match, positions);
+        std::sort(positions.begin(), positions.end());
+        for (int j = 0; j < positions.size(); ++j) {
+            if (j > 0) output.put(' ');
+            output.write_int(positions[j]);
+        }
+        output.put('\n');
+    }
+    if (!locate) output.put('\n');
+}
+
+// Count the occurrences of every pattern with an index of the BWT, one by
+// one or a batch at a time, and write the counts
+template <typename Index>
+void MatchPatterns(InputReader& input,
+                   const Index& index,
+                   const KmerTable& kmers,
+                   int pattern_count,
+                   int max_mismatches,
+                   int batch_size) {
+    OutputWriter output;
+    STRINGS_PHASE("query");
+    if (max_mismatches > 0 || batch_size == 1) {
+        for (int pi = 0; pi < pattern_count; ++pi) {
+            Span pattern = input.next_token();
+            int occ_count = max_mismatches == 0
+                ? CountOccurrences(pattern, index, kmers)
+                : CountApproximateOccurrences(pattern, max_mismatches, index);
+            output.write_int(occ_count);
+            output.put(' ');
+        }
+        output.put('\n');
+        return;
+    }
+
+    // Match the exact patterns a batch at a time
+    vector<Span> patterns;
+    vector<int> counts;
+    for (int first = 0; first < pattern_count; first += batch_size) {
+        patterns.clear();
+        for (int pi = first; pi < std::min(first + batch_size, pattern_count); ++pi) {
+            patterns.push_back(input.next_token());
+        }
+        CountOccurrencesBatch(patterns, index, kmers, counts);
+        for (int occ_count : counts) {
+            output.write_int(occ_count);
+            output.put(' ');
+        }
+    }
+    output.put('\n');
+}
+
+// Answer the requests of clients over a Unix domain socket until stopped, see
+// common/query_server.h. Every request gets the counts of its patterns. The
+// patterns of the requests batched together are matched together. Return the
+// exit status.
+template <typename Index>
+int ServePatterns(const string& path,
+                   const Index& index,
+                   const KmerTable& kmers,
+                   int max_mismatches,
+                   int batch_size,
+                   int threads) {
+    QueryServer::Options options;
+    options.threads = threads;
+    QueryServer server(path, [&](const vector<QueryServer::Request*>& batch) {
+        vector<Span> patterns, chunk;
+        for (const QueryServer::Request* request : batch) {
+            patterns.insert(patterns.end(), request->patterns.begin(), request->patterns.end());
+        }
+        STRINGS_COUNT(queries, patterns.size());
+
+        vector<int> counts, chunk_counts;
+        for (size_t first = 0; first < patterns.size(); first += batch_size) {
+            chunk.assign(patterns.begin() + first, patterns.begin() + std::min(first + batch_size, patterns.size()));
+            if (max_mismatches == 0) {
+                CountOccurrencesBatch(chunk, index, kmers, chunk_counts);
+            } else {
+                chunk_counts.clear();
+                for (const Span& pattern : chunk) {
+                    chunk_counts.push_back(CountApproximateOccurrences(pattern, max_mismatches, index));
+                }
+            }
+            counts.insert(counts.end(), chunk_counts.begin(), chunk_counts.end());
+        }
+
+        size_t next = 0;
+        for (QueryServer::Request* request : batch) {
+            for (size_t j = 0; j < request->patterns.size(); ++j) {
+                if (j > 0) request->response += ' ';
+                request->response += std::to_string(counts[next++]);
+            }
+        }
+    }, options);
+    try {
+        fprintf(stderr, "serving on %s\n", path.c_str());
+        server.run();
+    } catch (const std::exception& error) {
+        fprintf(stderr, "%s\n", error.what());
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    // With -k K, count occurrences with up to K mismatches.
+    // With --rlbwt, count exact occurrences with the run-length encoded BWT.
+    // With --locate, write their positions, also with the run-length encoded BWT.
+    // Neither takes -k, --batch or --serve.
+    // With --batch N, match exact patterns N at a time in lockstep, 1 matches them one by one.
+    // With --kmers K, start exact matching of DNA from a table of the intervals of all K-mers,
+    // loaded from and saved to FILE with --kmer-table FILE.
+    // With --wavelet, use the wavelet matrix index, which is also the one for texts other than DNA.
+    // With --smem L, write the super-maximal exact matches of at least L letters of every read.
+    // With --serve PATH, read only the BWT and answer pattern requests on the Unix domain socket PATH
+    // until SIGINT or SIGTERM, with --threads N workers.
+    int max_mismatches = 0;
+    bool run_length = false;
+    bool locate = false;
+    int batch_size = 0;
+    int kmer_length = 0;
+    string kmer_path;
+    bool wavelet = false;
+    int smem_length = 0;
+    string serve_path;
+    int threads = 0;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "-k" && i + 1 < argc) {
+            max_mismatches = std::stoi(argv[++i]);
+        } else if (arg == "--rlbwt") {
+            run_length = true;
+        } else if (arg == "--locate") {
+            locate = true;
+        } else if (arg == "--batch" && i + 1 < argc) {
+            batch_size = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--kmers" && i + 1 < argc) {
+            kmer_length = std::max(0, std::min(MaxKmerLength, std::stoi(argv[++i])));
+        } else if (arg == "--kmer-table" && i + 1 < argc) {
+            kmer_path = argv[++i];
+        } else if (arg == "--wavelet") {
+            wavelet = true;
+        } else if (arg == "--smem" && i + 1 < argc) {
+            smem_length = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--serve" && i + 1 < argc) {
+            serve_path = argv[++i];
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threads = std::max(0, std::stoi(argv[++i]));
+        } else {
+            fprintf(stderr, "usage: %s [-k K] [--rlbwt] [--locate] [--batch N] [--kmers K] [--kmer-table FILE] [--wavelet]"
+                            " [--smem L] [--serve PATH] [--threads N] < input > output\n", argv[0]);
+            return 1;
+        }
+    }
+    if (max_mismatches < 0) {
+        fprintf(stderr, "-k needs a number of mismatches of at least 0\n");
+        return 1;
+    }
+
+    // The run-length encoded BWT only does exact matching, on the patterns of the input
+    if ((run_length || locate) && (max_mismatches > 0 || batch_size > 0)) {
+        fprintf(stderr, "--rlbwt and --locate only match exact patterns one by one, not with -k or --batch\n");
+        return 1;
+    }
+    if ((run_length || locate) && !serve_path.empty()) {
+        fprintf(stderr, "--serve does not take --rlbwt or --locate\n");
+        return 1;
+    }
+
+    // SMEMs have their own bidirectional index and output
+    if (smem_length > 0 && (max_mismatches > 0 || kmer_length > 0 || batch_size > 0 || !serve_path.empty() || wavelet || run_length || locate)) {
+        fprintf(stderr, "--smem does not take -k, --kmers, --batch, --serve, --wavelet, --rlbwt or --locate\n");
+        return 1;
+    }
 
-    // First occurrence of each character in the sorted list of characters of bwt
-    map<char, int> starts;
+    // The k-mer table only serves exact matching with the DNA index
+    if (kmer_length > 0 && (max_mismatches > 0 || wavelet || run_length || locate)) {
+        fprintf(stderr, "--kmers only serves exact matching of DNA, not with -k, --wavelet, --rlbwt or --locate\n");
+        return 1;
+    }
+    if (!kmer_path.empty() && kmer_length == 0) {
+        fprintf(stderr, "--kmer-table needs --kmers\n");
+        return 1;
+    }
+    if (batch_size == 0) batch_size = DefaultBatchSize;
 
-    // Occurrence counts for each character and each position in bwt
-    map<char, vector<int>> occ_count_before;
+    InputReader input;
+    Span bwt = input.next_token();
+    int pattern_count = input.next_int();
+    STRINGS_COUNT(characters, bwt.size());
+    STRINGS_COUNT(queries, pattern_count);
+
+    if (run_length || locate) {
+        MatchRunLengthBWT(input, bwt, pattern_count, locate);
+        return 0;
+    }
+
+    // Texts over other alphabets than DNA get the wavelet index,
+    // with O(log sigma) per LF step
+    bool dna = true;
+    for (size_t i = 0; i < bwt.size() && dna; ++i) {
+        dna = letter_to_index(bwt[i]) >= 0;
+    }
+    if (kmer_length > 0 && !dna) {
+        fprintf(stderr, "--kmers needs the BWT of a DNA text\n");
+        return 1;
+    }
+    if (smem_length > 0) {
+        if (!dna) {
+            fprintf(stderr, "--smem needs the BWT of a DNA text\n");
+            return 1;
+        }
+        MatchSMEMs(input, bwt, pattern_count, smem_length);
+        return 0;
+    }
+    wavelet = wavelet || !dna;
+    KmerTable kmers;
+    if (wavelet) {
+        WaveletIndex index;
+        PreprocessWaveletBWT(bwt, index);
+        STRINGS_COUNT(index_bytes, index.bwt.bytes());
+        if (!serve_path.empty()) {
+            return ServePatterns(serve_path, index, kmers, max_mismatches, batch_size, threads);
+        }
+        MatchPatterns(input, index, kmers, pattern_count, max_mismatches, batch_size);
+        return 0;
+    }
 
     // Preprocess the BWT once to get starts and occ_count_before.
     // For each pattern, we will then use these precomputed values and
     // spend only O(|pattern|) to find all occurrences of the pattern
     // in the text instead of O(|pattern| + |text|).
-    PreprocessBWT(bwt, starts, occ_count_before);
+    OccurrenceIndex index;
+    PreprocessBWT(bwt, index);
+    STRINGS_COUNT(index_bytes, index.occ_count_before.size() * sizeof(int));
 
-    // Get the pattern to find and return the result
-    for (int pi = 0; pi < pattern_count; ++pi) {
-        string pattern;
-        cin >> pattern;
-        int occ_count = CountOccurrences(pattern, bwt, starts, occ_count_before);
-        printf("%d ", occ_count);
+    if (kmer_length > 0) {
+        kmers = PrepareKmerTable(bwt, index, kmer_length, kmer_path);
+        STRINGS_COUNT(kmer_table_bytes, kmers.intervals.size() * sizeof(RowInterval));
+    }
+
+    if (!serve_path.empty()) {
+        return ServePatterns(serve_path, index, kmers, max_mismatches, batch_size, threads);
     }
-    printf("\n");
+    MatchPatterns(input, index, kmers, pattern_count, max_mismatches, batch_size);
     return 0;
 }
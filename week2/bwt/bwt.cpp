@@ -3,13 +3,16 @@
 #include <string>
 #include <vector>
 
-using std::cin;
+#include "../../common/fast_input.h"
+#include "../../common/instrument.h"
+
 using std::cout;
 using std::endl;
 using std::string;
 using std::vector;
 
 string BWT(const string& text) {
+    STRINGS_PHASE("transform");
     int n = text.size();
     vector<int> indices(n);
     string result(n, ' ');
@@ -29,8 +32,9 @@ string BWT(const string& text) {
 }
 
 int main() {
-    string text;
-    cin >> text;
+    InputReader input;
+    string text = input.next_sequence().str();
+    STRINGS_COUNT(characters, text.size());
     cout << BWT(text) << endl;
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,534 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <deque>
+#include <future>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include "../../common/fast_output.h"
+#include "../../common/instrument.h"
+#include "../../common/suffix_sort.h"
+#include "../../common/thread_pool.h"
+
+using std::string;
+using std::vector;
+
+// Block-sorting compressor in the style of bzip2, built on the Burrows-Wheeler
+// transform of week2/bwt and its inverse of week2/bwtinverse. The input is cut
+// into blocks, and every block goes through the BWT, move-to-front, run-length
+// coding of the zeros and a Huffman code. Blocks are independent, so they are
+// compressed and decompressed on a thread pool while the main thread reads the
+// next blocks and writes the finished ones in order.
+//
+// The compressed stream starts with the magic "BWTZ". Every block follows
+// with a header of three little-endian 32-bit words (its length, the row of
+// the block among its sorted rotations and the length of the payload) and the
+// payload: the code length of every symbol, one byte each, and the code. A
+// header with length 0 ends the stream.
+
+char const Magic[4] = {'B', 'W', 'T', 'Z'};
+int const HeaderSize = 12;
+int const DefaultBlockSize = 900000;
+
+// Symbols of the Huffman code. RunA and RunB write the length of a run of
+// zeros after move-to-front in bijective base 2, digits 1 and 2 from the
+// least significant one. Any other value v becomes the symbol v + 1.
+int const RunA = 0;
+int const RunB = 1;
+int const EndOfBlock = 257;
+int const Symbols = 258;
+
+// Longest code, and codes up to LookupBits long are decoded with one table lookup
+int const MaxCodeLength = 20;
+int const LookupBits = 11;
+
+void put_word(string& out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) out.push_back(char(value >> (8 * i)));
+}
+
+uint32_t get_word(const char* in) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i) value |= uint32_t((unsigned char)in[i]) << (8 * i);
+    return value;
+}
+
+// Burrows-Wheeler transform of a block by sorting its rotations. The block
+// needs no '$', the row of the block itself among the rotations is returned
+// in primary instead.
+string BlockBWT(const string& block, int& primary) {
+    STRINGS_PHASE("bwt");
+    int n = block.size();
+    vector<int> classes;
+    vector<int> order = sort_cyclic_shifts(block.data(), n, classes);
+    string bwt(n, ' ');
+    primary = 0;
+    for (int i = 0; i < n; ++i) {
+        if (order[i] == 0) primary = i;
+        bwt[i] = block[order[i] == 0 ? n - 1 : order[i] - 1];
+    }
+    return bwt;
+}
+
+// Rebuild the block from its BWT and primary row by following LF backwards
+// from the row of the block, as week2/bwtinverse does from the row of '$'
+string InverseBlockBWT(const string& bwt, int primary) {
+    STRINGS_PHASE("inverse_bwt");
+    int n = bwt.size();
+
+    // First row of every character in the sorted first column
+    vector<int> starts(256, 0);
+    for (int i = 0; i < n; ++i) starts[(unsigned char)bwt[i]]++;
+    for (int c = 0, total = 0; c < 256; ++c) {
+        int count = starts[c];
+        starts[c] = total;
+        total += count;
+    }
+
+    // LF of every row: the row of the rotation one character to the left
+    vector<int> lf(n);
+    for (int i = 0; i < n; ++i) lf[i] = starts[(unsigned char)bwt[i]]++;
+
+    string block(n, ' ');
+    int row = primary;
+    for (int k = n - 1; k >= 0; --k) {
+        block[k] = bwt[row];
+        row = lf[row];
+    }
+    return block;
+}
+
+// Move-to-front of the BWT followed by the run-length coding of the zeros,
+// counting how often every symbol is used
+vector<uint16_t> MoveToFront(const string& bwt, vector<int>& frequencies) {
+    STRINGS_PHASE("mtf");
+    unsigned char order[256];
+    for (int c = 0; c < 256; ++c) order[c] = c;
+    vector<uint16_t> symbols;
+    symbols.reserve(bwt.size() / 2 + 1);
+    frequencies.assign(Symbols, 0);
+
+    int zeros = 0;
+    auto flush_zeros = [&] () {
+        while (zeros > 0) {
+            int digit = zeros & 1 ? 1 : 2;
+            symbols.push_back(digit == 1 ? RunA : RunB);
+            frequencies[symbols.back()]++;
+            zeros = (zeros - digit) / 2;
+        }
+    };
+
+    for (size_t i = 0; i < bwt.size(); ++i) {
+        unsigned char c = bwt[i];
+        if (order[0] == c) {
+            zeros++;
+            continue;
+        }
+        flush_zeros();
+
+        // Find the character and move it to the front
+        int j = 1;
+        while (order[j] != c) ++j;
+        memmove(order + 1, order, j);
+        order[0] = c;
+        symbols.push_back(j + 1);
+        frequencies[j + 1]++;
+    }
+    flush_zeros();
+    symbols.push_back(EndOfBlock);
+    frequencies[EndOfBlock]++;
+    return symbols;
+}
+
+// Code lengths of a Huffman code for the frequencies, 0 for unused symbols.
+// While the longest code is too long, the frequencies are halved and the code
+// built again, as bzip2 does.
+vector<uint8_t> HuffmanLengths(vector<int> frequencies) {
+    int n = frequencies.size();
+    vector<uint8_t> lengths(n, 0);
+    for (;;) {
+        // Leaves are nodes 0..n-1, the internal nodes follow
+        typedef std::pair<long long, int> Weighted;
+        std::priority_queue<Weighted, vector<Weighted>, std::greater<Weighted>> queue;
+        for (int s = 0; s < n; ++s) {
+            if (frequencies[s] > 0) queue.push(Weighted(frequencies[s], s));
+        }
+        if (queue.size() == 1) {
+            lengths[queue.top().second] = 1;
+            return lengths;
+        }
+        vector<int> parent(2 * n, -1);
+        int next = n;
+        while (queue.size() > 1) {
+            Weighted a = queue.top();
+            queue.pop();
+            Weighted b = queue.top();
+            queue.pop();
+            parent[a.second] = parent[b.second] = next;
+            queue.push(Weighted(a.first + b.first, next++));
+        }
+
+        // The length of a code is the depth of its leaf
+        int longest = 0;
+        for (int s = 0; s < n; ++s) {
+            if (frequencies[s] == 0) continue;
+            int depth = 0;
+            for (int node = s; parent[node] != -1; node = parent[node]) depth++;
+            lengths[s] = depth;
+            longest = std::max(longest, depth);
+        }
+        if (longest <= MaxCodeLength) return lengths;
+        for (auto& frequency : frequencies) {
+            if (frequency > 0) frequency = frequency / 2 + 1;
+        }
+    }
+}
+
+// Canonical codes of the lengths: shorter codes first, by symbol within a length
+vector<uint32_t> CanonicalCodes(const vector<uint8_t>& lengths) {
+    vector<uint32_t> codes(lengths.size(), 0);
+    uint32_t code = 0;
+    for (int length = 1; length <= MaxCodeLength; ++length) {
+        for (size_t s = 0; s < lengths.size(); ++s) {
+            if (lengths[s] == length) codes[s] = code++;
+        }
+        code <<= 1;
+    }
+    return codes;
+}
+
+// Writes codes most significant bit first
+class BitWriter {
+public:
+    explicit BitWriter(string& out) : out_(out), buffer_(0), bits_(0) {}
+
+    void put(uint32_t code, int length) {
+        buffer_ = buffer_ << length | code;
+        bits_ += length;
+        while (bits_ >= 8) {
+            bits_ -= 8;
+            out_.push_back(char(buffer_ >> bits_));
+        }
+    }
+
+    // Pad the last byte with zeros
+    void finish() {
+        if (bits_ > 0) out_.push_back(char(buffer_ << (8 - bits_)));
+        bits_ = 0;
+    }
+
+private:
+    string& out_;
+    uint64_t buffer_;
+    int bits_;
+};
+
+// Reads what BitWriter wrote, with zeros past the end
+class BitReader {
+public:
+    BitReader(const char* data, size_t size) : data_(data), size_(size), pos_(0), buffer_(0), bits_(0) {}
+
+    // Next length bits without consuming them, length up to 32
+    uint32_t peek(int length) {
+        while (bits_ < length) {
+            uint64_t byte = pos_ < size_ ? (unsigned char)data_[pos_] : 0;
+            pos_++;
+            buffer_ = buffer_ << 8 | byte;
+            bits_ += 8;
+        }
+        return uint32_t(buffer_ >> (bits_ - length)) & ((1u << length) - 1);
+    }
+
+    void skip(int length) {
+        bits_ -= length;
+    }
+
+    // Whether more bits were consumed than written
+    bool overrun() const {
+        return pos_ > size_ + 8;
+    }
+
+private:
+    const char* data_;
+    size_t size_;
+    size_t pos_;
+    uint64_t buffer_;
+    int bits_;
+};
+
+// Canonical Huffman decoder: a table for the short codes, and for the longer
+// ones the first code and the number of codes of every length
+class HuffmanDecoder {
+public:
+    explicit HuffmanDecoder(const vector<uint8_t>& lengths)
+        : table_(1 << LookupBits, 0), first_(MaxCodeLength + 2, 0), count_(MaxCodeLength + 2, 0), offset_(MaxCodeLength + 2, 0) {
+        for (size_t s = 0; s < lengths.size(); ++s) count_[lengths[s]]++;
+        count_[0] = 0;
+        uint32_t code = 0;
+        int index = 0;
+        for (int length = 1; length <= MaxCodeLength; ++length) {
+            first_[length] = code;
+            offset_[length] = index;
+            code = (code + count_[length]) << 1;
+            index += count_[length];
+        }
+        sorted_.resize(index);
+        vector<int> filled(MaxCodeLength + 1, 0);
+        for (size_t s = 0; s < lengths.size(); ++s) {
+            int length = lengths[s];
+            if (length == 0) continue;
+            int rank = filled[length]++;
+            sorted_[offset_[length] + rank] = s;
+
+            // Every table entry starting with a short code decodes to its symbol
+            if (length <= LookupBits) {
+                uint32_t prefix = (first_[length] + rank) << (LookupBits - length);
+                for (uint32_t e = 0; e < (1u << (LookupBits - length)); ++e) {
+                    table_[prefix + e] = uint32_t(s) << 8 | length;
+                }
+            }
+        }
+    }
+
+    // Decode one symbol, -1 for a code that is not in the table
+    int decode(BitReader& bits) const {
+        uint32_t entry = table_[bits.peek(LookupBits)];
+        if (entry != 0) {
+            bits.skip(entry & 0xff);
+            return entry >> 8;
+        }
+        for (int length = LookupBits + 1; length <= MaxCodeLength; ++length) {
+            uint32_t code = bits.peek(length);
+            if (code - first_[length] < uint32_t(count_[length])) {
+                bits.skip(length);
+                return sorted_[offset_[length] + code - first_[length]];
+            }
+        }
+        return -1;
+    }
+
+private:
+    vector<uint32_t> table_;  // symbol << 8 | length, 0 for longer codes
+    vector<uint32_t> first_;
+    vector<int> count_;
+    vector<int> offset_;
+    vector<int> sorted_;      // Symbols by code
+};
+
+// Compress a block into its header and payload
+string CompressBlock(const string& block) {
+    STRINGS_COUNT(blocks, 1);
+    int primary;
+    string bwt = BlockBWT(block, primary);
+    vector<int> frequencies;
+    vector<uint16_t> symbols = MoveToFront(bwt, frequencies);
+
+    STRINGS_PHASE("huffman");
+    vector<uint8_t> lengths = HuffmanLengths(frequencies);
+    vector<uint32_t> codes = CanonicalCodes(lengths);
+    string payload(lengths.begin(), lengths.end());
+    BitWriter bits(payload);
+    for (uint16_t symbol : symbols) bits.put(codes[symbol], lengths[symbol]);
+    bits.finish();
+
+    string out;
+    put_word(out, block.size());
+    put_word(out, primary);
+    put_word(out, payload.size());
+    out += payload;
+    return out;
+}
+
+// Decompress the payload of a block of the given length and primary row
+string DecompressBlock(const string& payload, int n, int primary) {
+    if (payload.size() < Symbols || n < 0 || primary < 0 || primary >= n) throw std::runtime_error("corrupt block header");
+    vector<uint8_t> lengths(payload.begin(), payload.begin() + Symbols);
+    for (uint8_t length : lengths) {
+        if (length > MaxCodeLength) throw std::runtime_error("corrupt code lengths");
+    }
+
+    // Undo the Huffman code, the run-length coding and move-to-front at once
+    string bwt;
+    {
+        STRINGS_PHASE("huffman_decode");
+        HuffmanDecoder decoder(lengths);
+        BitReader bits(payload.data() + Symbols, payload.size() - Symbols);
+        unsigned char order[256];
+        for (int c = 0; c < 256; ++c) order[c] = c;
+        bwt.reserve(n);
+        long long zeros = 0, weight = 1;
+        for (;;) {
+            int symbol = decoder.decode(bits);
+            if (symbol < 0 || bits.overrun()) throw std::runtime_error("corrupt code");
+            if (symbol == RunA || symbol == RunB) {
+                zeros += weight * (symbol == RunA ? 1 : 2);
+                weight *= 2;
+                if (zeros > n) throw std::runtime_error("corrupt run");
+                continue;
+            }
+            bwt.append(zeros, order[0]);
+            zeros = 0;
+            weight = 1;
+            if (symbol == EndOfBlock) break;
+
+            int j = symbol - 1;
+            unsigned char c = order[j];
+            memmove(order + 1, order, j);
+            order[0] = c;
+            bwt.push_back(c);
+            if (int(bwt.size()) > n) throw std::runtime_error("corrupt block length");
+        }
+        if (int(bwt.size()) != n) throw std::runtime_error("corrupt block length");
+    }
+    return InverseBlockBWT(bwt, primary);
+}
+
+// Read up to size bytes, fewer only at the end of the input
+size_t read_full(int fd, char* data, size_t size) {
+    size_t done = 0;
+    while (done < size) {
+        ssize_t count = read(fd, data + done, size - done);
+        if (count <= 0) break;
+        done += count;
+    }
+    return done;
+}
+
+// Compress standard input to standard output, keeping up to two blocks per
+// worker in flight. Return the bytes read and written.
+std::pair<size_t, size_t> Compress(ThreadPool& pool, int block_size) {
+    OutputWriter output;
+    output.write(Magic, sizeof(Magic));
+    size_t read_bytes = 0, written = sizeof(Magic);
+    std::deque<std::future<string>> pending;
+
+    for (;;) {
+        string block(block_size, '\0');
+        size_t count = read_full(0, &block[0], block_size);
+        if (count == 0) break;
+        block.resize(count);
+        read_bytes += count;
+        STRINGS_COUNT(characters, count);
+        pending.push_back(pool.submit([block = std::move(block)] { return CompressBlock(block); }));
+
+        // Write the oldest blocks while the newer ones are being compressed
+        while (pending.size() > 2 * pool.size()) {
+            string compressed = pending.front().get();
+            pending.pop_front();
+            output.write(compressed.data(), compressed.size());
+            written += compressed.size();
+        }
+    }
+    for (auto& block : pending) {
+        string compressed = block.get();
+        output.write(compressed.data(), compressed.size());
+        written += compressed.size();
+    }
+
+    // The end of the stream
+    string end;
+    for (int i = 0; i < 3; ++i) put_word(end, 0);
+    output.write(end.data(), end.size());
+    written += end.size();
+    return std::make_pair(read_bytes, written);
+}
+
+// Decompress standard input to standard output the same way
+std::pair<size_t, size_t> Decompress(ThreadPool& pool) {
+    char magic[sizeof(Magic)];
+    if (read_full(0, magic, sizeof(magic)) != sizeof(magic) || memcmp(magic, Magic, sizeof(Magic)) != 0) {
+        throw std::runtime_error("not a compressed stream");
+    }
+    OutputWriter output;
+    size_t read_bytes = sizeof(Magic), written = 0;
+    std::deque<std::future<string>> pending;
+
+    for (;;) {
+        char header[HeaderSize];
+        if (read_full(0, header, HeaderSize) != HeaderSize) throw std::runtime_error("truncated stream");
+        read_bytes += HeaderSize;
+        int n = get_word(header);
+        int primary = get_word(header + 4);
+        uint32_t payload_size = get_word(header + 8);
+        if (n == 0) break;
+        string payload(payload_size, '\0');
+        if (read_full(0, &payload[0], payload_size) != payload_size) throw std::runtime_error("truncated stream");
+        read_bytes += payload_size;
+        pending.push_back(pool.submit([payload = std::move(payload), n, primary] { return DecompressBlock(payload, n, primary); }));
+
+        while (pending.size() > 2 * pool.size()) {
+            string block = pending.front().get();
+            pending.pop_front();
+            output.write(block.data(), block.size());
+            written += block.size();
+        }
+    }
+    for (auto& future : pending) {
+        string block = future.get();
+        output.write(block.data(), block.size());
+        written += block.size();
+    }
+    STRINGS_COUNT(characters, written);
+    return std::make_pair(read_bytes, written);
+}
+
+double cpu_seconds() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+}
+
+int main(int argc, char** argv) {
+    // With -d, decompress instead of compressing.
+    // With -b BYTES, cut the input into blocks of that size.
+    // With -t THREADS, use that many workers instead of one per core.
+    // With -v, report the ratio and the throughput on standard error.
+    bool decompress = false;
+    bool verbose = false;
+    int block_size = DefaultBlockSize;
+    int threads = 0;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "-d") {
+            decompress = true;
+        } else if (arg == "-b" && i + 1 < argc) {
+            block_size = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "-t" && i + 1 < argc) {
+            threads = std::max(0, std::stoi(argv[++i]));
+        } else if (arg == "-v") {
+            verbose = true;
+        } else {
+            fprintf(stderr, "usage: %s [-d] [-b BLOCK_SIZE] [-t THREADS] [-v] < input > output\n", argv[0]);
+            return 1;
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::pair<size_t, size_t> bytes;
+    ThreadPool pool(threads);
+    try {
+        bytes = decompress ? Decompress(pool) : Compress(pool, block_size);
+    } catch (const std::exception& error) {
+        fprintf(stderr, "%s\n", error.what());
+        return 1;
+    }
+
+    if (verbose) {
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        double cpu = cpu_seconds();
+        size_t plain = decompress ? bytes.second : bytes.first;
+        size_t packed = decompress ? bytes.first : bytes.second;
+        fprintf(stderr, "%zu -> %zu bytes, ratio %.3f, %.3f bits per byte, %.2f MB/s, %.2f MB/s per core (%zu threads)\n",
+                bytes.first, bytes.second, plain > 0 ? double(plain) / packed : 0.0, plain > 0 ? 8.0 * packed / plain : 0.0,
+                plain / 1e6 / seconds, plain / 1e6 / cpu, pool.size());
+    }
+    return 0;
+}
@@ -3,13 +3,16 @@
 #include <string>
 #include <vector>
 
-using std::cin;
+#include "../../common/fast_input.h"
+#include "../../common/instrument.h"
+
 using std::cout;
 using std::endl;
 using std::string;
 using std::vector;
 
 string InverseBWT(const string& bwt) {
+    STRINGS_PHASE("transform");
     int n = bwt.size();
     vector<int> next(n);
     int index = -1;
@@ -32,8 +35,9 @@ string InverseBWT(const string& bwt) {
 }
 
 int main() {
-    string bwt;
-    cin >> bwt;
+    InputReader input;
+    string bwt = input.next_sequence().str();
+    STRINGS_COUNT(characters, bwt.size());
     cout << InverseBWT(bwt) << endl;
     return 0;
 }
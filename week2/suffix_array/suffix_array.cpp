@@ -4,9 +4,10 @@
 #include <vector>
 #include <utility>
 
-using std::cin;
-using std::cout;
-using std::endl;
+#include "../../common/fast_input.h"
+#include "../../common/fast_output.h"
+#include "../../common/instrument.h"
+
 using std::make_pair;
 using std::pair;
 using std::string;
@@ -18,6 +19,7 @@ using std::vector;
 // in text where the i-th lexicographically smallest
 // suffix of text starts.
 vector<int> BuildSuffixArray(const string& text) {
+    STRINGS_PHASE("build_suffix_array");
     int n = text.size();
     vector<int> result(n);
 
@@ -29,12 +31,15 @@ vector<int> BuildSuffixArray(const string& text) {
 }
 
 int main() {
-    string text;
-    cin >> text;
+    InputReader input;
+    string text = input.next_sequence().str();
+    STRINGS_COUNT(characters, text.size());
     vector<int> suffix_array = BuildSuffixArray(text);
+    OutputWriter output;
     for (int i = 0; i < suffix_array.size(); ++i) {
-        cout << suffix_array[i] << ' ';
+        output.write_int(suffix_array[i]);
+        output.put(' ');
     }
-    cout << endl;
+    output.put('\n');
     return 0;
 }
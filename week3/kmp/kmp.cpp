@@ -3,11 +3,16 @@
 #include <string>
 #include <vector>
 
-using std::cin;
+#include "../../common/fast_input.h"
+#include "../../common/fast_output.h"
+#include "../../common/instrument.h"
+
 using std::string;
 using std::vector;
 
 vector<int> get_prefix_function(string p) {
+    STRINGS_PHASE("prefix_function");
+
     // initialize data structure
     int n = p.size();
     vector<int> s(n);
@@ -19,6 +24,7 @@ vector<int> get_prefix_function(string p) {
     for (int i = 1; i < n; ++i) {
         // Explore valid borders until we find that the last character of the border is equal to p[i]
         while (border > 0 && p[i] != p[border]){
+            STRINGS_COUNT(border_fallbacks, 1);
             border = s[border - 1];
         }
 
@@ -63,14 +69,28 @@ vector<int> find_pattern(const string& pattern, const string& text) {
     return result;
 }
 
-int main() {
-    string pattern, text;
-    cin >> pattern;
-    cin >> text;
+int main(int argc, char** argv) {
+    // With --binary, write the positions delta-encoded as varints
+    bool binary = argc > 1 && string(argv[1]) == "--binary";
+
+    InputReader input;
+    string pattern = input.next_sequence().str();
+    string text = input.next_sequence().str();
+    STRINGS_COUNT(characters, text.size());
     vector<int> result = find_pattern(pattern, text);
+    OutputWriter output;
+    if (binary) {
+        DeltaPositionWriter positions(output);
+        for (int i = 0; i < result.size(); ++i) {
+            positions.add(result[i]);
+        }
+        positions.finish();
+        return 0;
+    }
     for (int i = 0; i < result.size(); ++i) {
-        printf("%d ", result[i]);
+        output.write_int(result[i]);
+        output.put(' ');
     }
-    printf("\n");
+    output.put('\n');
     return 0;
 }
@@ -1,27 +1,33 @@
 #include <algorithm>
+#include <cstdio>
 #include <iostream>
 #include <string>
 #include <vector>
 #include <utility>
 
-using std::cin;
-using std::cout;
-using std::endl;
+#include "../../common/enhanced_suffix_array.h"
+#include "../../common/fast_input.h"
+#include "../../common/fast_output.h"
+#include "../../common/instrument.h"
+#include "../../common/lce.h"
+
 using std::make_pair;
 using std::pair;
 using std::string;
 using std::vector;
 
-// Text contains symbols A, C, G, T only and the ending symbol “$” 
-int const Letters = 5;
+// Text contains symbols A, C, G, T only and the ending symbol “$”,
+// plus the separator “#” of two texts when looking for MUMs
+int const Letters = 6;
 
 int letter_to_index(char letter) {
 	switch (letter) {
         case '$': return 0; break;
-		case 'A': return 1; break;
-		case 'C': return 2; break;
-		case 'G': return 3; break;
-		case 'T': return 4; break;
+        case '#': return 1; break;
+		case 'A': return 2; break;
+		case 'C': return 3; break;
+		case 'G': return 4; break;
+		case 'T': return 5; break;
 		default: return -1; break;
 	}
 }
@@ -140,6 +146,8 @@ vector<int> UpdateClasses(vector<int>& newOrder, vector<int>& classes, int l) {
 // in text where the i-th lexicographically smallest
 // suffix of text starts.
 vector<int> BuildSuffixArray(const string& text) {
+    STRINGS_PHASE("build_suffix_array");
+
     // Get the order considering the first character of each suffix
     vector<int> order = SortCharacters(text);
 
@@ -151,6 +159,8 @@ vector<int> BuildSuffixArray(const string& text) {
 
     // While loop, it stops when L is equal or greater than the size of text
     while (l < text.size()) {
+        STRINGS_COUNT(doubling_rounds, 1);
+
         // Update order by doubling L
         order = SortDoubled(text, l, order, classes);
 
@@ -163,13 +173,216 @@ vector<int> BuildSuffixArray(const string& text) {
     return order;
 }
 
-int main() {
-    string text;
-    cin >> text;
+// Left context of the suffixes below a node of the suffix tree: the character
+// before all of them, or Diverse when they are preceded by different
+// characters or one of them starts the text. A repeat is left maximal when
+// its context is diverse, right maximal when it is the label of a node.
+struct LeftContext {
+    static char const Diverse = 0;
+    static char const None = 1;  // No suffix yet
+    char left;
+
+    static LeftContext of_suffix(const string& text, int start) {
+        return LeftContext{start == 0 ? Diverse : text[start - 1]};
+    }
+
+    void merge(const LeftContext& other) {
+        if (left == None) {
+            left = other.left;
+        } else if (left != other.left) {
+            left = Diverse;
+        }
+    }
+};
+
+// Visitor writing every maximal repeat of at least min_length characters
+// as its length followed by the starts of its occurrences
+struct MaximalRepeats {
+    typedef LeftContext State;
+
+    const string& text;
+    const EnhancedSuffixArray& esa;
+    const int min_length;
+    OutputWriter& output;
+
+    State leaf(int i) const {
+        return LeftContext::of_suffix(text, esa.suffix(i));
+    }
+
+    State open(int, int) const {
+        return State{LeftContext::None};
+    }
+
+    void child(State& parent, int, const State& child, const EnhancedSuffixArray::Interval&) {
+        parent.merge(child);
+    }
+
+    void close(State& state, const EnhancedSuffixArray::Interval& interval) {
+        if (interval.lcp < min_length || state.left != LeftContext::Diverse) return;
+        STRINGS_COUNT(repeats, 1);
+        output.write_int(interval.lcp);
+        for (int i = interval.lb; i <= interval.rb; ++i) {
+            output.put(' ');
+            output.write_int(esa.suffix(i));
+        }
+        output.put('\n');
+    }
+};
+
+// Visitor writing every maximal unique match of at least min_length
+// characters between the texts before and after the separator, as the
+// start in the first text, the start in the second one and the length
+struct MaximalUniqueMatches {
+    typedef LeftContext State;
+
+    const string& text;
+    const EnhancedSuffixArray& esa;
+    const int separator;
+    const int min_length;
+    OutputWriter& output;
+
+    State leaf(int i) const {
+        return LeftContext::of_suffix(text, esa.suffix(i));
+    }
+
+    State open(int, int) const {
+        return State{LeftContext::None};
+    }
+
+    void child(State& parent, int, const State& child, const EnhancedSuffixArray::Interval&) {
+        parent.merge(child);
+    }
+
+    void close(State& state, const EnhancedSuffixArray::Interval& interval) {
+        // Unique in both texts: the node has just two suffixes, one in each text
+        if (interval.lcp < min_length || interval.rb - interval.lb != 1 || state.left != LeftContext::Diverse) return;
+        int first = std::min(esa.suffix(interval.lb), esa.suffix(interval.rb));
+        int second = std::max(esa.suffix(interval.lb), esa.suffix(interval.rb));
+        if (first > separator || second < separator) return;
+        STRINGS_COUNT(repeats, 1);
+        output.write_int(first);
+        output.put(' ');
+        output.write_int(second - separator - 1);
+        output.put(' ');
+        output.write_int(interval.lcp);
+        output.put('\n');
+    }
+};
+
+EnhancedSuffixArray BuildEnhancedSuffixArray(const string& text) {
+    vector<int> suffix_array = BuildSuffixArray(text);
+    STRINGS_PHASE("build_lcp_array");
+    return EnhancedSuffixArray(text, std::move(suffix_array));
+}
+
+// Write the longest substring occurring at least twice, with its length and
+// its first occurrences in suffix array order, or just 0 when there is none
+void WriteLongestRepeat(const string& text, const EnhancedSuffixArray& esa, OutputWriter& output) {
+    int best = 0;
+    for (int i = 1; i < esa.size(); ++i) {
+        if (esa.lcp(i) > esa.lcp(best)) best = i;
+    }
+    int length = esa.lcp(best);
+    output.write_int(length);
+    if (length > 0) {
+        output.put(' ');
+        output.write_int(esa.suffix(best - 1));
+        output.put(' ');
+        output.write_int(esa.suffix(best));
+        output.put(' ');
+        output.write(text.data() + esa.suffix(best), length);
+    }
+    output.put('\n');
+}
+
+// Read the queries i j and write the longest common extension of each pair of
+// suffixes, one per line. Return the exit status.
+int AnswerLongestCommonExtensions(InputReader& input, const string& text, const EnhancedSuffixArray& esa, int block, OutputWriter& output) {
+    LongestCommonExtension lce = [&] {
+        STRINGS_PHASE("build_rmq");
+        return LongestCommonExtension(esa, block);
+    }();
+    STRINGS_COUNT(index_bytes, esa.bytes() + lce.bytes());
+
+    int query_count = input.next_int();
+    vector<pair<int, int>> queries(query_count);
+    for (auto& query : queries) {
+        query.first = input.next_int();
+        query.second = input.next_int();
+        if (query.first < 0 || query.first >= (int)text.size() || query.second < 0 || query.second >= (int)text.size()) {
+            fprintf(stderr, "position out of the text: %d %d\n", query.first, query.second);
+            return 1;
+        }
+    }
+    STRINGS_COUNT(queries, query_count);
+
+    vector<int> lengths;
+    {
+        STRINGS_PHASE("lce");
+        lce.lce(queries, lengths);
+    }
+    for (int length : lengths) {
+        output.write_int(length);
+        output.put('\n');
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    // With --longest-repeat, write the longest repeated substring instead of the suffix array.
+    // With --maximal-repeats L, write the maximal repeats of at least L characters.
+    // With --mums L, read two texts without '$' and write their maximal unique
+    // matches of at least L characters.
+    // With --lce B, read a count of queries and the pairs of positions i j after
+    // the text, and write the longest common extension of each pair, using
+    // LCP blocks of B values (default: 16).
+    string mode;
+    int argument = 0;
+    if (argc > 1) {
+        mode = argv[1];
+        if (argc > 2) argument = std::stoi(argv[2]);
+    }
+    if (argc > 3 || (!mode.empty() && mode != "--longest-repeat" && mode != "--maximal-repeats" && mode != "--mums" && mode != "--lce")) {
+        fprintf(stderr, "usage: %s [--longest-repeat | --maximal-repeats L | --mums L | --lce B] < input > output\n", argv[0]);
+        return 1;
+    }
+    int min_length = std::max(1, argument);
+
+    InputReader input;
+    string text = input.next_sequence().str();
+    int separator = -1;
+    if (mode == "--mums") {
+        separator = text.size();
+        text += '#';
+        text += input.next_sequence().str();
+        text += '$';
+    }
+    STRINGS_COUNT(characters, text.size());
+
+    if (!mode.empty()) {
+        EnhancedSuffixArray esa = BuildEnhancedSuffixArray(text);
+        OutputWriter output;
+        STRINGS_PHASE("query");
+        if (mode == "--longest-repeat") {
+            WriteLongestRepeat(text, esa, output);
+        } else if (mode == "--maximal-repeats") {
+            MaximalRepeats repeats{text, esa, min_length, output};
+            esa.bottom_up(repeats);
+        } else if (mode == "--mums") {
+            MaximalUniqueMatches matches{text, esa, separator, min_length, output};
+            esa.bottom_up(matches);
+        } else if (mode == "--lce") {
+            return AnswerLongestCommonExtensions(input, text, esa, argument > 0 ? argument : 16, output);
+        }
+        return 0;
+    }
+
     vector<int> suffix_array = BuildSuffixArray(text);
+    OutputWriter output;
     for (int i = 0; i < suffix_array.size(); ++i) {
-        cout << suffix_array[i] << ' ';
+        output.write_int(suffix_array[i]);
+        output.put(' ');
     }
-    cout << endl;
+    output.put('\n');
     return 0;
 }
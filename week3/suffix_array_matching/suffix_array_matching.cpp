@@ -1,10 +1,20 @@
+#include <cstdint>
 #include <cstdio>
+#include <cstring>
 #include <iostream>
 #include <string>
+#include <utility>
 #include <vector>
 #include <algorithm>
 
-using std::cin;
+#include "../../common/compressed_suffix_array.h"
+#include "../../common/fast_input.h"
+#include "../../common/fast_output.h"
+#include "../../common/instrument.h"
+#include "../../common/query_server.h"
+
+using std::make_pair;
+using std::pair;
 using std::string;
 using std::vector;
 
@@ -136,6 +146,8 @@ vector<int> UpdateClasses(vector<int>& newOrder, vector<int>& classes, int l) {
 // in text where the i-th lexicographically smallest
 // suffix of text starts.
 vector<int> BuildSuffixArray(const string& text) {
+    STRINGS_PHASE("build_suffix_array");
+
     // Get the order considering the first character of each suffix
     vector<int> order = SortCharacters(text);
 
@@ -147,6 +159,8 @@ vector<int> BuildSuffixArray(const string& text) {
 
     // While loop, it stops when L is equal or greater than the size of text
     while (l < text.size()) {
+        STRINGS_COUNT(doubling_rounds, 1);
+
         // Update order by doubling L
         order = SortDoubled(text, l, order, classes);
 
@@ -172,10 +186,11 @@ bool isLexicographicallySmaller(const string& text1, const string& text2, const
     return false;
 }
 
-vector<int> FindOccurrences(const string& pattern, const string& text, const vector<int>& suffix_array) {
-    // Get size of the strings
+// Find the interval [start, end) of the suffix array whose suffixes start with
+// pattern[pattern_start, pattern_start + m), using two binary searches.
+pair<int, int> FindInterval(const string& pattern, int pattern_start, int m, const string& text, const vector<int>& suffix_array) {
+    // Get size of the text
     int n = text.size();
-    int m = pattern.size();
 
     // Define pointers to start binary search
     int min_index = 0;
@@ -185,8 +200,9 @@ vector<int> FindOccurrences(const string& pattern, const string& text, const vec
     while (min_index < max_index) {
         int mid_index = (min_index + max_index) / 2;
         int start = suffix_array[mid_index];
+        STRINGS_COUNT(binary_search_comparisons, 1);
 
-        if (isLexicographicallySmaller(text, pattern, start, 0, std::min(n - start, m))) {
+        if (isLexicographicallySmaller(text, pattern, start, pattern_start, std::min(n - start, m))) {
             min_index = mid_index + 1;
         } else {
             max_index = mid_index;
@@ -203,8 +219,9 @@ vector<int> FindOccurrences(const string& pattern, const string& text, const vec
     while (min_index < max_index) {
         int mid_index = (min_index + max_index) / 2;
         int start = suffix_array[mid_index];
+        STRINGS_COUNT(binary_search_comparisons, 1);
 
-        if (isLexicographicallySmaller(pattern, text, 0, start, std::min(n - start, m))) {
+        if (isLexicographicallySmaller(pattern, text, pattern_start, start, std::min(n - start, m))) {
             max_index = mid_index;
         } else {
             min_index = mid_index + 1;
@@ -214,41 +231,347 @@ vector<int> FindOccurrences(const string& pattern, const string& text, const vec
     // Save the results from max_index, it is the ending index of matches
     int end = max_index;
 
+    return make_pair(start, end);
+}
+
+vector<int> FindOccurrences(const string& pattern, const string& text, const vector<int>& suffix_array) {
+    // Get the interval of the suffixes starting with the pattern
+    pair<int, int> interval = FindInterval(pattern, 0, pattern.size(), text, suffix_array);
+
     // Get the matches in the corresponding positions of text
     vector<int> result;
-    if (start < end) {
-        for (int i = start; i < end; ++i) {
-            result.push_back(suffix_array[i]);
+    for (int i = interval.first; i < interval.second; ++i) {
+        result.push_back(suffix_array[i]);
+    }
+
+    return result;
+}
+
+// Same search on the compressed suffix array, reading the suffixes through Psi
+pair<int, int> FindInterval(const string& pattern, int pattern_start, int m, const CompressedSuffixArray& csa) {
+    // Binary search to find the starting index of matches
+    int min_index = 0;
+    int max_index = csa.size();
+    while (min_index < max_index) {
+        int mid_index = (min_index + max_index) / 2;
+        STRINGS_COUNT(binary_search_comparisons, 1);
+        if (csa.compare(mid_index, pattern, pattern_start, m) < 0) {
+            min_index = mid_index + 1;
+        } else {
+            max_index = mid_index;
         }
     }
+    int start = min_index;
+
+    // Binary search to find the ending index of matches
+    max_index = csa.size();
+    while (min_index < max_index) {
+        int mid_index = (min_index + max_index) / 2;
+        STRINGS_COUNT(binary_search_comparisons, 1);
+        if (csa.compare(mid_index, pattern, pattern_start, m) > 0) {
+            max_index = mid_index;
+        } else {
+            min_index = mid_index + 1;
+        }
+    }
+    return make_pair(start, max_index);
+}
 
+vector<int> FindOccurrences(const string& pattern, const CompressedSuffixArray& csa) {
+    pair<int, int> interval = FindInterval(pattern, 0, pattern.size(), csa);
+    vector<int> result;
+    for (int i = interval.first; i < interval.second; ++i) {
+        STRINGS_COUNT(located, 1);
+        result.push_back(csa.locate(i));
+    }
     return result;
 }
 
-int main() {
-    char buffer[100001];
-    scanf("%s", buffer);
-    string text = buffer;
+// Count the mismatches between the first len characters of a and b, stopping
+// early once they exceed limit. Eight characters are compared per step: the XOR
+// of two 8-byte words has a non-zero byte exactly at the mismatching characters.
+int CountMismatches(const char* a, const char* b, int len, int limit) {
+    int mismatches = 0;
+    int i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t x, y;
+        memcpy(&x, a + i, 8);
+        memcpy(&y, b + i, 8);
+
+        // Fold every byte of the XOR into its lowest bit and count the bytes set
+        uint64_t diff = x ^ y;
+        diff |= diff >> 4;
+        diff |= diff >> 2;
+        diff |= diff >> 1;
+        mismatches += __builtin_popcountll(diff & 0x0101010101010101ULL);
+        if (mismatches > limit) return mismatches;
+    }
+
+    // Compare the remaining characters one by one
+    for (; i < len; ++i) {
+        mismatches += a[i] != b[i];
+    }
+    return mismatches;
+}
+
+// Mark in occurs every position of the text where the pattern occurs with at
+// most max_mismatches mismatches, appending to found the positions that were
+// not marked yet. By the pigeonhole principle, splitting the
+// pattern into max_mismatches + 1 seeds leaves at least one seed matching
+// exactly, so each seed is searched in the suffix array and the candidate
+// positions it gives are verified against the whole pattern.
+void FindApproximateOccurrences(const string& pattern, int max_mismatches, const string& text, const vector<int>& suffix_array, vector<bool>& occurs, vector<int>& found) {
+    // Get size of the strings, the text ends with $ which never matches
+    int n = text.size() - 1;
+    int m = pattern.size();
+    if (m > n) return;
+
+    // Every position matches when all characters may mismatch
+    if (m <= max_mismatches) {
+        for (int i = 0; i + m <= n; ++i) {
+            if (occurs[i]) continue;
+            occurs[i] = true;
+            found.push_back(i);
+        }
+        return;
+    }
+
+    // Split the pattern into seeds of almost equal length
+    int seeds = max_mismatches + 1;
+    for (int seed = 0; seed < seeds; ++seed) {
+        int seed_start = seed * m / seeds;
+        int seed_length = (seed + 1) * m / seeds - seed_start;
+
+        // Find the exact matches of the seed
+        pair<int, int> interval = FindInterval(pattern, seed_start, seed_length, text, suffix_array);
+
+        // Verify the pattern around each match
+        for (int i = interval.first; i < interval.second; ++i) {
+            int candidate = suffix_array[i] - seed_start;
+            if (candidate < 0 || candidate + m > n || occurs[candidate]) continue;
+            STRINGS_COUNT(candidates_verified, 1);
+            if (CountMismatches(text.data() + candidate, pattern.data(), m, max_mismatches) <= max_mismatches) {
+                occurs[candidate] = true;
+                found.push_back(candidate);
+            }
+        }
+    }
+}
+
+// Same search on the compressed suffix array, the candidates being verified
+// against the text extracted from it
+void FindApproximateOccurrences(const string& pattern, int max_mismatches, const CompressedSuffixArray& csa, vector<bool>& occurs, vector<int>& found) {
+    int n = csa.size() - 1;
+    int m = pattern.size();
+    if (m > n) return;
+    if (m <= max_mismatches) {
+        for (int i = 0; i + m <= n; ++i) {
+            if (occurs[i]) continue;
+            occurs[i] = true;
+            found.push_back(i);
+        }
+        return;
+    }
+
+    string window(m, ' ');
+    int seeds = max_mismatches + 1;
+    for (int seed = 0; seed < seeds; ++seed) {
+        int seed_start = seed * m / seeds;
+        int seed_length = (seed + 1) * m / seeds - seed_start;
+        pair<int, int> interval = FindInterval(pattern, seed_start, seed_length, csa);
+        for (int i = interval.first; i < interval.second; ++i) {
+            int candidate = csa.locate(i) - seed_start;
+            if (candidate < 0 || candidate + m > n || occurs[candidate]) continue;
+            STRINGS_COUNT(candidates_verified, 1);
+            csa.extract(candidate, m, &window[0]);
+            if (CountMismatches(window.data(), pattern.data(), m, max_mismatches) <= max_mismatches) {
+                occurs[candidate] = true;
+                found.push_back(candidate);
+            }
+        }
+    }
+}
+
+// Mark in occurs the positions where the pattern occurs, exactly or with up
+// to max_mismatches mismatches, appending to found the positions that were not
+// marked yet. The index is the text and its suffix array, or the compressed
+// suffix array.
+template <typename... Index>
+void MarkOccurrences(const string& pattern, int max_mismatches, vector<bool>& occurs, vector<int>& found, const Index&... index) {
+    if (max_mismatches > 0) {
+        FindApproximateOccurrences(pattern, max_mismatches, index..., occurs, found);
+        return;
+    }
+    for (int position : FindOccurrences(pattern, index...)) {
+        if (occurs[position]) continue;
+        occurs[position] = true;
+        found.push_back(position);
+    }
+}
+
+// Answer the requests of clients over a Unix domain socket until stopped, see
+// common/query_server.h. Every request gets the sorted positions of the text
+// of n characters where any of its patterns occurs, as marked by
+// mark(pattern, occurs, found) like MarkOccurrences. Return the exit status.
+template <typename Mark>
+int ServePatterns(const string& path, int n, Mark mark, int threads) {
+    QueryServer::Options options;
+    options.threads = threads;
+    QueryServer server(path, [&](const vector<QueryServer::Request*>& batch) {
+        // Every worker keeps its marks, cleared after each request
+        thread_local vector<bool> occurs;
+        occurs.resize(n, false);
+        vector<int> positions;
+        for (QueryServer::Request* request : batch) {
+            STRINGS_COUNT(queries, request->patterns.size());
+            positions.clear();
+            for (const Span& pattern : request->patterns) {
+                mark(pattern.str(), occurs, positions);
+            }
+            std::sort(positions.begin(), positions.end());
+            for (size_t j = 0; j < positions.size(); ++j) {
+                occurs[positions[j]] = false;
+                if (j > 0) request->response += ' ';
+                request->response += std::to_string(positions[j]);
+            }
+        }
+    }, options);
+    try {
+        fprintf(stderr, "serving on %s\n", path.c_str());
+        server.run();
+    } catch (const std::exception& error) {
+        fprintf(stderr, "%s\n", error.what());
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    // With -k K, report occurrences with up to K mismatches.
+    // With --binary, write the positions delta-encoded as varints.
+    // With --csa, search a compressed suffix array built from the suffix array
+    // instead of the text and the suffix array, sampled every --sample S positions (default: 32).
+    // With --serve PATH, read only the text and answer pattern requests, with -k
+    // too, on the Unix domain socket PATH until SIGINT or SIGTERM, with --threads N workers.
+    // Options that would be ignored, such as --sample without --csa, are errors.
+    int max_mismatches = 0;
+    bool binary = false;
+    bool compressed = false;
+    int sample_step = 0;
+    string serve_path;
+    int threads = -1;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "-k" && i + 1 < argc) {
+            max_mismatches = std::stoi(argv[++i]);
+        } else if (arg == "--binary") {
+            binary = true;
+        } else if (arg == "--csa") {
+            compressed = true;
+        } else if (arg == "--sample" && i + 1 < argc) {
+            sample_step = std::stoi(argv[++i]);
+            if (sample_step < 1) {
+                fprintf(stderr, "--sample needs a step of at least 1\n");
+                return 1;
+            }
+        } else if (arg == "--serve" && i + 1 < argc) {
+            serve_path = argv[++i];
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threads = std::max(0, std::stoi(argv[++i]));
+        } else {
+            fprintf(stderr, "usage: %s [-k K] [--binary] [--csa [--sample S]] [--serve PATH [--threads N]] < input > output\n", argv[0]);
+            return 1;
+        }
+    }
+    if (max_mismatches < 0) {
+        fprintf(stderr, "-k needs a number of mismatches of at least 0\n");
+        return 1;
+    }
+    if (sample_step > 0 && !compressed) {
+        fprintf(stderr, "--sample needs --csa\n");
+        return 1;
+    }
+    if (serve_path.empty() && threads >= 0) {
+        fprintf(stderr, "--threads needs --serve\n");
+        return 1;
+    }
+    if (!serve_path.empty() && binary) {
+        fprintf(stderr, "--serve answers in text, not with --binary\n");
+        return 1;
+    }
+    if (sample_step == 0) sample_step = 32;
+    threads = std::max(0, threads);
+
+    InputReader input;
+    string text = input.next_sequence().str();
     text += '$';
+
+    // Positions are ints in both indexes, see common/compressed_suffix_array.h
+    if (text.size() > CompressedSuffixArray::MaxLength) {
+        fprintf(stderr, "text too long: at most %zu characters\n", CompressedSuffixArray::MaxLength - 1);
+        return 1;
+    }
+    int n = text.size();
     vector<int> suffix_array = BuildSuffixArray(text);
-    int pattern_count;
-    scanf("%d", &pattern_count);
-    vector<bool> occurs(text.length(), false);
 
-    for (int pattern_index = 0; pattern_index < pattern_count; ++pattern_index) {
-        scanf("%s", buffer);
-        string pattern = buffer;
-        vector<int> occurrences = FindOccurrences(pattern, text, suffix_array);
-        for (int j = 0; j < occurrences.size(); ++j) {
-            occurs[occurrences[j]] = true;
+    // The compressed suffix array replaces the text and the suffix array
+    CompressedSuffixArray csa;
+    if (compressed) {
+        {
+            STRINGS_PHASE("build_csa");
+            csa = CompressedSuffixArray(text, suffix_array, sample_step);
+        }
+        STRINGS_COUNT(index_bytes, csa.bytes());
+        string().swap(text);
+        vector<int>().swap(suffix_array);
+    } else {
+        STRINGS_COUNT(index_bytes, text.size() + suffix_array.size() * sizeof(int));
+    }
+
+    if (!serve_path.empty()) {
+        if (compressed) {
+            return ServePatterns(serve_path, n, [&](const string& pattern, vector<bool>& occurs, vector<int>& found) {
+                MarkOccurrences(pattern, max_mismatches, occurs, found, csa);
+            }, threads);
+        }
+        return ServePatterns(serve_path, n, [&](const string& pattern, vector<bool>& occurs, vector<int>& found) {
+            MarkOccurrences(pattern, max_mismatches, occurs, found, text, suffix_array);
+        }, threads);
+    }
+    int pattern_count = input.next_int();
+    vector<bool> occurs(n, false);
+    STRINGS_COUNT(characters, n - 1);
+    STRINGS_COUNT(queries, pattern_count);
+
+    {
+        STRINGS_PHASE("query");
+        vector<int> found;
+        for (int pattern_index = 0; pattern_index < pattern_count; ++pattern_index) {
+            string pattern = input.next_token().str();
+            found.clear();
+            if (compressed) {
+                MarkOccurrences(pattern, max_mismatches, occurs, found, csa);
+            } else {
+                MarkOccurrences(pattern, max_mismatches, occurs, found, text, suffix_array);
+            }
         }
     }
 
+    OutputWriter output;
+    if (binary) {
+        DeltaPositionWriter positions(output);
+        for (int i = 0; i < occurs.size(); ++i) {
+            if (occurs[i]) positions.add(i);
+        }
+        positions.finish();
+        return 0;
+    }
     for (int i = 0; i < occurs.size(); ++i) {
         if (occurs[i]) {
-            printf("%d ", i);
+            output.write_int(i);
+            output.put(' ');
         }
     }
-    printf("\n");
+    output.put('\n');
     return 0;
 }
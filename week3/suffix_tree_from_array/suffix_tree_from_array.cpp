@@ -6,6 +6,12 @@
 #include <vector>
 #include <iostream>
 
+#include "../../common/arena.h"
+#include "../../common/fast_input.h"
+#include "../../common/fast_output.h"
+#include "../../common/instrument.h"
+#include "../../common/tree_traversal.h"
+
 using std::make_pair;
 using std::map;
 using std::pair;
@@ -27,7 +33,12 @@ struct Edge {
     Edge(const Edge& e) : node(e.node), start(e.start), end(e.end) {}
 };
 
-void create_new_leaf(map<int, vector<Edge>>& tree, const string& text, int& node, int& depth, int& node_counting, int suffix) {
+// Outgoing edges of every node. The map nodes and the edge vectors are
+// allocated from the current arena, see common/arena.h.
+typedef vector<Edge, ArenaAllocator<Edge>> EdgeList;
+typedef map<int, EdgeList, std::less<int>, ArenaAllocator<pair<const int, EdgeList>>> SuffixTree;
+
+void create_new_leaf(SuffixTree& tree, const string& text, int& node, int& depth, int& node_counting, int suffix) {
     // Get the size of the text
     int n = text.size();
 
@@ -41,7 +52,7 @@ void create_new_leaf(map<int, vector<Edge>>& tree, const string& text, int& node
 
     // Add the edge to the tree
     if (tree.count(node) == 0) {
-        vector<Edge> new_edges;
+        EdgeList new_edges;
         tree[node] = new_edges;
     }
     tree[node].push_back(edge);
@@ -51,7 +62,7 @@ void create_new_leaf(map<int, vector<Edge>>& tree, const string& text, int& node
     depth = n - suffix;
 }
 
-void create_mid_node(map<int, vector<Edge>>& tree, const string& text, int& node, int& depth, int& node_counting, int edge_start, int offset) {
+void create_mid_node(SuffixTree& tree, const string& text, int& node, int& depth, int& node_counting, int edge_start, int offset) {
     // Get the ID of the mid node and update the node counting
     int mid_node = ++node_counting;
 
@@ -68,7 +79,7 @@ void create_mid_node(map<int, vector<Edge>>& tree, const string& text, int& node
 
     // Update the existing edge and add to mid node's children
     existing_edge.start += offset;
-    vector<Edge> edges;
+    EdgeList edges;
     edges.push_back(existing_edge);
     tree[mid_node] = edges;
 
@@ -88,9 +99,11 @@ void create_mid_node(map<int, vector<Edge>>& tree, const string& text, int& node
 // must be represented by Edge(1, 6, 7). This edge must be present in the vector tree[0]
 // (corresponding to the root node), and it should be the first edge in the vector 
 // (because it has the smallest first character of all edges outgoing from the root).
-map<int, vector<Edge>> SuffixTreeFromSuffixArray(const vector<int>& suffix_array, const vector<int>& lcp_array, const string& text) {
+SuffixTree SuffixTreeFromSuffixArray(const vector<int>& suffix_array, const vector<int>& lcp_array, const string& text) {
+    STRINGS_PHASE("build_tree");
+
     // Define a mapping to store the tree
-    map<int, vector<Edge>> tree;
+    SuffixTree tree;
 
     // Define a vector to use as a stack to traverse the tree
     vector<pair<int, int>> stack(1, make_pair(0, 0));
@@ -109,6 +122,7 @@ map<int, vector<Edge>> SuffixTreeFromSuffixArray(const vector<int>& suffix_array
 
         // Go up the tree until getting depth <= lcpPrev
         while (depth > lcp_prev) {
+            STRINGS_COUNT(stack_pops, 1);
             stack.pop_back();
             pair<int, int> back = stack.back();
             curr_node = back.first;
@@ -144,62 +158,143 @@ map<int, vector<Edge>> SuffixTreeFromSuffixArray(const vector<int>& suffix_array
     return tree;
 }
 
-int main() {
-    char buffer[200001];
-    scanf("%s", buffer);
-    string text = buffer;
+// Emit the edges of the suffix tree of a text of n characters as soon as
+// they are final, with the single scan of SuffixTreeFromSuffixArray but
+// without building the tree. next_lcp() returns the LCP values one by one,
+// so they may come straight from the input. The visitor provides
+//
+//   void edge(int start, int end)    the edge labelled text[start, end)
+//
+// An edge may still be split while the scan is below it, so it is final
+// only once the subtree under it is complete: the edges come in post-order,
+// each one after the subtree below it, the children in the order of the
+// suffix array. Only the current path is kept, as the depth of every node
+// and the start of one suffix below it.
+template <typename NextLcp, typename Visitor>
+void StreamSuffixTree(const vector<int>& suffix_array, NextLcp next_lcp, Visitor& visitor) {
+    STRINGS_PHASE("stream_tree");
+    struct Frame {
+        int depth;
+        int suffix;
+    };
+
+    int n = suffix_array.size();
+    vector<Frame> stack(1, Frame{0, 0});
+    for (int i = 0; i < n; ++i) {
+        // Add the leaf of the suffix below the deepest node of the path
+        stack.push_back(Frame{n - suffix_array[i], suffix_array[i]});
+
+        // Close the nodes deeper than the prefix shared with the next suffix,
+        // the root last
+        int lcp = i + 1 < n ? next_lcp() : 0;
+        while (stack.back().depth > lcp) {
+            STRINGS_COUNT(stack_pops, 1);
+            Frame node = stack.back();
+            stack.pop_back();
+
+            // A node between the parent and this one, at the depth of the
+            // LCP, when the next suffix leaves the edge in its middle
+            if (stack.back().depth < lcp) {
+                STRINGS_COUNT(mid_nodes, 1);
+                stack.push_back(Frame{lcp, node.suffix});
+            }
+            visitor.edge(node.suffix + stack.back().depth, node.suffix + node.depth);
+        }
+    }
+}
+
+// Visitor of StreamSuffixTree that writes every edge as "start end"
+struct EdgeStreamWriter {
+    OutputWriter& output;
+
+    void edge(int start, int end) {
+        output.write_int(start);
+        output.put(' ');
+        output.write_int(end);
+        output.put('\n');
+    }
+};
+
+// Visitor that writes the edges of the tree in depth-first order, each
+// edge right before the subtree below it
+struct EdgeWriter {
+    const SuffixTree& tree;
+    OutputWriter& output;
+
+    bool enter(int) {
+        return true;
+    }
+
+    int degree(int node) const {
+        SuffixTree::const_iterator it = tree.find(node);
+        return it == tree.end() ? 0 : it->second.size();
+    }
+
+    int child(int node, int edge_index) {
+        const Edge& edge = tree.find(node)->second[edge_index];
+        output.write_int(edge.start);
+        output.put(' ');
+        output.write_int(edge.end);
+        output.put('\n');
+        return edge.node;
+    }
+
+    void leave(int) {}
+};
+
+int main(int argc, char** argv) {
+    // With --stream, write the edges in post-order as they are built, each
+    // edge after the subtree below it, reading the LCP array as it goes
+    // instead of building the tree.
+    bool stream = false;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--stream") {
+            stream = true;
+        } else {
+            fprintf(stderr, "usage: %s [--stream] < input > output\n", argv[0]);
+            return 1;
+        }
+    }
+
+    InputReader input;
+    string text = input.next_sequence().str();
     vector<int> suffix_array(text.length());
     for (int i = 0; i < text.length(); ++i) {
-        scanf("%d", &suffix_array[i]);
+        suffix_array[i] = input.next_int();
+    }
+    if (stream) {
+        STRINGS_COUNT(characters, text.size());
+        OutputWriter output;
+        output.write(text);
+        output.put('\n');
+        EdgeStreamWriter writer{output};
+        StreamSuffixTree(suffix_array, [&input] { return input.next_int(); }, writer);
+        return 0;
     }
     vector<int> lcp_array(text.length() - 1);
     for (int i = 0; i + 1 < text.length(); ++i) {
-        scanf("%d", &lcp_array[i]);
+        lcp_array[i] = input.next_int();
     }
+    // The tree lives in the arena until the end of the program
+    Arena arena;
+    ArenaScope scope(arena);
+
     // Build the suffix tree and get a mapping from 
     // suffix tree node ID to the list of outgoing Edges.
-    map<int, vector<Edge>> tree = SuffixTreeFromSuffixArray(suffix_array, lcp_array, text);
-    printf("%s\n", buffer);
+    SuffixTree tree = SuffixTreeFromSuffixArray(suffix_array, lcp_array, text);
+    STRINGS_COUNT(characters, text.size());
+    STRINGS_COUNT(tree_nodes, tree.size());
+    OutputWriter output;
+    output.write(text);
+    output.put('\n');
 
     // Output the edges of the suffix tree in the required order.
     // Note that we use here the contract that the root of the tree
     // will have node ID = 0 and that each vector of outgoing edges
     // will be sorted by the first character of the corresponding edge label.
-    //
-    // The following code avoids recursion to avoid stack overflow issues.
-    // It uses a stack to convert recursive function to a while loop.
-    // The stack stores pairs (node, edge_index). 
-    // This code is an equivalent of 
-    //
-    //    OutputEdges(tree, 0);
-    //
-    // for the following _recursive_ function OutputEdges:
-    //
-    // void OutputEdges(map<int, vector<Edge> > tree, int node_id) {
-    //   const vector<Edge>& edges = tree[node_id];
-    //   for (int edge_index = 0; edge_index < edges.size(); ++edge_index) {
-    //     printf("%d %d\n", edges[edge_index].start, edges[edge_index].end);
-    //     OutputEdges(tree, edges[edge_index].node);
-    //   }
-    // }
-    //
-    vector<pair<int, int>> stack(1, make_pair(0, 0));
-
-    while (!stack.empty()) {
-        pair<int, int> p = stack.back();
-        stack.pop_back();
-        int node = p.first;
-        int edge_index = p.second;
-        if (!tree.count(node)) {
-            continue;
-        }
-        const vector<Edge>& edges = tree[node];
-        if (edge_index + 1 < edges.size()) {
-            stack.push_back(make_pair(node, edge_index + 1));
-        }
-        printf("%d %d\n", edges[edge_index].start, edges[edge_index].end);
-        stack.push_back(make_pair(edges[edge_index].node, 0));
-    }
+    EdgeWriter writer{tree, output};
+    depth_first(0, writer);
 
     return 0;
 }